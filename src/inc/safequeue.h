@@ -4,11 +4,27 @@
 #include <queue>
 #include "support/tinythread.h"
 
+// Determines what happens when an item is pushed onto a full (bounded) queue.
+enum QueueDropPolicy
+{
+    QUEUE_DROP_OLDEST, // Discard the oldest item in the queue to make room for the new one.
+    QUEUE_BLOCK        // Wait until a consumer makes room in the queue.
+};
+
 template <typename T>
 class SafeQueue
 {
     public:
-        T pop() 
+        // A capacity of 0 creates an unbounded queue.
+        SafeQueue(size_t capacity = 0, QueueDropPolicy policy = QUEUE_BLOCK)
+        {
+            _capacity = capacity;
+            _policy = policy;
+            _closed = false;
+            _dropped = 0;
+        }
+
+        T pop()
         {
             tthread::lock_guard<tthread::mutex> mlock(_mutex);
             while (_queue.empty()) {
@@ -16,14 +32,63 @@ class SafeQueue
             }
             T val = _queue.front();
             _queue.pop();
+            _not_full.notify_one();
             return val;
         }
 
+        // Waits for an item and stores it in 'item'.  Returns false once the queue
+        // has been closed and every remaining item has been consumed.
+        bool pop(T& item)
+        {
+            tthread::lock_guard<tthread::mutex> mlock(_mutex);
+            while (_queue.empty() && !_closed) {
+                _cond.wait(_mutex);
+            }
+            if (_queue.empty()) {
+                return false;
+            }
+            item = _queue.front();
+            _queue.pop();
+            _not_full.notify_one();
+            return true;
+        }
+
         void push(const T& item)
+        {
+            T dropped_item;
+            push(item, dropped_item);
+        }
+
+        // Adds an item to the queue.  Returns true if the queue was full and the oldest
+        // item had to be discarded to make room, in which case it is stored in 'dropped_item'.
+        bool push(const T& item, T& dropped_item)
         {
             tthread::lock_guard<tthread::mutex> mlock(_mutex);
+            bool dropped = false;
+            if (_capacity > 0) {
+                if (_policy == QUEUE_BLOCK) {
+                    while (_queue.size() >= _capacity && !_closed) {
+                        _not_full.wait(_mutex);
+                    }
+                } else if (_queue.size() >= _capacity) {
+                    dropped_item = _queue.front();
+                    _queue.pop();
+                    _dropped++;
+                    dropped = true;
+                }
+            }
             _queue.push(item);
             _cond.notify_one();
+            return dropped;
+        }
+
+        // Wakes up every waiting consumer.  Once the remaining items are consumed, pop(T&) returns false.
+        void close()
+        {
+            tthread::lock_guard<tthread::mutex> mlock(_mutex);
+            _closed = true;
+            _cond.notify_all();
+            _not_full.notify_all();
         }
 
         bool empty()
@@ -31,10 +96,29 @@ class SafeQueue
             return _queue.empty();
         }
 
+        size_t size()
+        {
+            tthread::lock_guard<tthread::mutex> mlock(_mutex);
+            return _queue.size();
+        }
+
+        // The number of items discarded under the QUEUE_DROP_OLDEST policy.
+        unsigned long dropped()
+        {
+            tthread::lock_guard<tthread::mutex> mlock(_mutex);
+            return _dropped;
+        }
+
     private:
         std::queue<T> _queue;
         tthread::mutex _mutex;
         tthread::condition_variable _cond;
+        tthread::condition_variable _not_full;
+
+        size_t _capacity;
+        QueueDropPolicy _policy;
+        bool _closed;
+        unsigned long _dropped;
 };
 
 #endif
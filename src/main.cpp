@@ -15,6 +15,7 @@
 */
 
 #include <cstdio>
+#include <csignal>
 #include <sstream>
 #include <iostream>
 #include <iterator>
@@ -27,20 +28,27 @@
 #include "support/filesystem.h"
 #include "support/timing.h"
 #include "support/platform.h"
+#include "support/tinythread.h"
 #include "video/videobuffer.h"
+#include "video/framesink.h"
+#include "video/frameretention.h"
+#include "video/shmring.h"
+#include "video/resultwriter.h"
+#include "inc/safequeue.h"
 #include "motiondetector.h"
+#include "detectionscheduler.h"
 #include "alpr.h"
+#include "platetracker.h"
 
 // Required for random string generation (random_string):
 #include <string>
 #include <random>
 
-// Required for deleting old files (remove_old_files):
-#include <dirent.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <ctime>
-#include <cstring>
+// Required for reordering pipeline output (run_pipeline):
+#include <map>
+
+// Required for distributing batch jobs between workers (run_batch):
+#include <deque>
 
 // This function generates a string of random characters of a given length:
 std::string random_string(size_t length) {
@@ -60,40 +68,6 @@ std::string random_string(size_t length) {
     return random_string;
 }
 
-// This function deletes all files from a given directory older than a given age in seconds:
-void remove_old_files(const std::string& directory, int age_seconds) {
-    DIR* dir = opendir(directory.c_str());
-    if (!dir) {
-        std::cerr << "{\"error\": \"Error opening directory: " << strerror(errno) << "\"}" << std::endl;
-        return;
-    }
-
-    struct dirent* entry;
-    time_t now = time(nullptr);
-    time_t threshold = now - age_seconds; // Determine the threshold, under which files will be deleted.
-
-    while ((entry = readdir(dir)) != nullptr) { // Iterate over each file in the directory.
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) { // Skip the "." and ".." entries.
-            continue;
-        }
-
-        std::string filePath = directory + "/" + entry->d_name;
-        struct stat fileStat;
-
-        if (stat(filePath.c_str(), &fileStat) == 0) {
-            if (fileStat.st_mtime < threshold) { // Check of the file is older than the threshold.
-                if (!remove(filePath.c_str()) == 0) {
-                    std::cerr << "{\"error\": \"Error deleting file: " << filePath << " - " << strerror(errno) << "\"}" << std::endl;
-                }
-            }
-        } else {
-            std::cerr << "{\"error\": \"Error getting file status: " << filePath << " - " << strerror(errno) << "\"}" << std::endl;
-        }
-    }
-
-    closedir(dir);
-}
-
 using namespace alpr;
 
 const std::string MAIN_WINDOW_NAME = "ALPR main window";
@@ -103,18 +77,170 @@ const std::string LAST_VIDEO_STILL_LOCATION = "/tmp/laststill.jpg";
 const std::string WEBCAM_PREFIX = "/dev/video";
 MotionDetector motiondetector;
 bool do_motiondetection = true;
+DetectionScheduler detection_scheduler; // Decides which parts of each frame of a video, webcam, or stream are searched for plates.
+int full_scan_interval = 1; // Every frame is searched in full by default.
+float scan_window = 1.0; // How far the area searched around each plate between full scans extends past it, as a multiple of the plate's size.
 bool save_each_frame = false;
+bool track_plates = false; // When set, plates are followed across video frames, and only read again when something changes.
+FrameSink* frame_sink = NULL; // Writes analyzed frames to /dev/shm in the background.
+ResultWriter* result_writer = NULL; // Prints the JSON results to stdout, in batches when stdout isn't a terminal.
+const size_t OUTPUT_BUFFER_SIZE = 64 * 1024; // The amount of output collected before it is written out.
+std::string shm_ring_name = ""; // When set, analyzed frames and their results are also copied into a shared memory ring buffer with this name.
+int shm_ring_slots = 8;
+ShmRing shm_ring;
+tthread::mutex shm_ring_mutex;
+std::string shm_ring_json; // Reused for the JSON results of every frame copied into the ring buffer.
+const uint64_t SHM_RING_RESULTS_CAPACITY = 256 * 1024; // The space reserved for the JSON results of each frame.
+
+// A single frame passed between the stages of the processing pipeline.
+struct PipelineFrame {
+    int64_t frame_number;
+    cv::Mat frame;
+    std::vector<AlprRegionOfInterest> regionsOfInterest;
+    AlprResults results;
+    bool dropped; // This is set when the frame was discarded from the queue before it could be analyzed.
+};
+
+// Decides which frames of a video file are analyzed.  Frames in between are grabbed without being decoded, and the file stops being read at the end of the time window.
+struct VideoDecimation {
+    double step; // The number of frames from one analyzed frame to the next.
+    double next_frame; // The index of the next frame to analyze.
+    int64_t frame_index; // The index of the next frame in the capture, counted from the start of the time window.
+    double frame_ms; // The duration of each frame, or 0 if the frame rate of the file is unknown.
+    int start_ms;
+    int end_ms; // The time at which to stop reading, or 0 to read until the end of the file.
+};
+
+// The state shared between the capture thread, the recognition workers, and the output stage.
+struct PipelineState {
+    cv::VideoCapture* cap;
+    VideoDecimation* decimation; // This is NULL when every frame should be read.
+    SafeQueue<PipelineFrame>* frames; // Frames waiting for a recognition worker.
+    SafeQueue<PipelineFrame>* results; // Analyzed (or dropped) frames waiting for the output stage.
+    int64_t frames_captured;
+    int active_workers;
+    tthread::mutex mutex;
+};
+
+struct PipelineWorker {
+    PipelineState* state;
+    Alpr* alpr;
+};
+
+// A queue of file indexes belonging to a single batch worker.
+struct BatchQueue {
+    std::deque<size_t> jobs;
+    tthread::mutex mutex;
+};
+
+// The state shared between the batch workers and the output stage.
+struct BatchState {
+    std::vector<std::string> files;
+    std::vector<BatchQueue*> queues; // Each worker takes jobs from the front of its own queue, and steals from the back of the others when it runs out.
+    std::vector<std::string> output; // The JSON output for each file, in input order.
+    std::vector<bool> finished;
+    tthread::mutex output_mutex;
+    tthread::condition_variable output_ready;
+    tthread::mutex publish_mutex; // Prevents workers from writing the shared frame files at the same time.
+};
+
+struct BatchWorker {
+    BatchState* state;
+    Alpr* alpr;
+    size_t index;
+};
+
+// A live source analyzed in multi-stream mode.  Each stream has its own capture thread and motion detector.
+struct LiveStream {
+    int stream_id;
+    std::string source;
+    VideoBuffer* buffer;
+    MotionDetector motion;
+    DetectionScheduler scheduler;
+    PlateTracker tracker;
+    bool busy; // Set while a worker is analyzing a frame from this stream, so each stream is only analyzed by one worker at a time.
+    int64_t next_due_ms; // The earliest time this stream may be analyzed again, based on its frame rate cap.
+    int last_frame_number;
+    int64_t frames_analyzed;
+    int64_t frames_skipped;
+};
+
+// The state shared between the multi-stream recognition workers.
+struct StreamState {
+    std::vector<LiveStream*> streams;
+    int64_t min_interval_ms; // The minimum time between analyses of the same stream, or 0 for no limit.
+    tthread::mutex mutex;
+    tthread::mutex output_mutex; // Keeps the results from different workers from being interleaved.
+};
+
+struct StreamWorker {
+    StreamState* state;
+    Alpr* alpr;
+};
+
+// The state shared with the statistics thread.  The thread is stopped and joined before main() returns (including when it returns early), so it never prints while the program is shutting down.
+struct StatsState {
+    int interval; // The number of seconds between lines.
+    bool active;
+    tthread::mutex mutex;
+    tthread::thread* thread;
+
+    StatsState() : interval(0), active(false), thread(NULL) {}
+    ~StatsState() { stop(); }
+
+    void stop() {
+        if (thread == NULL) {
+            return;
+        }
+        {
+            tthread::lock_guard<tthread::mutex> guard(mutex);
+            active = false;
+        }
+        thread->join();
+        delete thread;
+        thread = NULL;
+    }
+};
 
 /** Function Headers */
-bool detectandshow(Alpr* alpr, cv::Mat frame, std::string region, bool save_each_frame);
+bool detectandshow(Alpr* alpr, cv::Mat frame, std::string region, bool save_each_frame, DetectionScheduler* scheduler = NULL);
+std::vector<AlprRegionOfInterest> get_regions_of_interest(cv::Mat& frame, MotionDetector& detector, DetectionScheduler* scheduler = NULL);
+AlprResults recognize_frame(Alpr* alpr, cv::Mat frame, std::vector<AlprRegionOfInterest> regionsOfInterest, PlateTracker* tracker = NULL);
+void output_tracks(PlateTracker* tracker, int stream_id);
+void output_results(AlprResults& results, cv::Mat frame, bool analyzed, bool save_each_frame);
+void prepare_output(AlprResults& results, cv::Mat frame, bool analyzed, bool save_each_frame);
+void write_shm_ring(cv::Mat& frame, AlprResults& results);
+void run_pipeline(cv::VideoCapture& cap, std::vector<Alpr*> alprs, size_t queue_size, QueueDropPolicy drop_policy, VideoDecimation* decimation = NULL);
+VideoDecimation init_decimation(cv::VideoCapture& cap, int every, double max_fps, int start_ms, int end_ms);
+bool read_decimated_frame(cv::VideoCapture& cap, cv::Mat& frame, VideoDecimation& decimation);
+void run_batch(std::vector<std::string> files, std::vector<Alpr*> alprs);
+bool run_live(std::string source, Alpr* alpr);
+void run_streams(std::vector<std::string> sources, std::vector<Alpr*> alprs, double max_fps);
+void stats_thread(void* arg);
+void print_stats();
 bool is_supported_video(std::string file_name);
 bool is_supported_image(std::string file_name);
+bool is_network_stream(std::string file_name);
+bool is_webcam(std::string file_name);
+std::string live_source(std::string file_name);
 
 std::string templatePattern;
 
 // This boolean is set to false when the user hits terminates (e.g., CTRL+C )
 // so we can end infinite loops for things like video processing.
-bool program_active = true;
+volatile sig_atomic_t program_active = true;
+
+// This function is called when the user asks the program to stop while live sources are being analyzed.  The frames in progress are finished, and the summaries are printed.  A second signal ends the program right away.
+void handle_stop_signal(int signal_number) {
+    program_active = false;
+    signal(signal_number, SIG_DFL);
+}
+
+// This function makes CTRL+C (and termination requests) stop the live loops gracefully while 'enable' is set, and restores the default behaviour afterwards.
+void catch_stop_signals(bool enable) {
+    signal(SIGINT, enable ? handle_stop_signal : SIG_DFL);
+    signal(SIGTERM, enable ? handle_stop_signal : SIG_DFL);
+}
 
 int main(int argc, const char** argv) {
     std::vector<std::string> filenames;
@@ -122,6 +248,21 @@ int main(int argc, const char** argv) {
     int seektoms = 0;
     std::string country;
     int topn;
+    bool use_pipeline = false;
+    int pipeline_workers = 1;
+    int queue_size = 8;
+    QueueDropPolicy drop_policy = QUEUE_BLOCK;
+    int batch_threads = 1;
+    FrameSinkFormat frame_format = FRAME_SINK_JPEG;
+    int jpeg_quality = 95;
+    int frame_max_age = 10;
+    int frame_max_count = 0;
+    double max_fps = 0;
+    int every = 1;
+    int end_ms = 0;
+    bool flush_each = false;
+    int flush_interval = 200;
+    int stats_interval = 0;
 
     TCLAP::CmdLine cmd("Phantom ALPR", ' ', Alpr::getVersion());
 
@@ -132,11 +273,58 @@ int main(int argc, const char** argv) {
     TCLAP::ValueArg<int> topNArg("n","topn","Max number of possible plate numbers to return.  Default=10",false, 10 ,"topN");
     TCLAP::SwitchArg motiondetect("", "motion", "Use motion detection on video file or stream.", cmd, false);
     TCLAP::SwitchArg saveframes("s", "save_frames", "Save each frame to `/dev/shm/phantomalpr/` with a unique identifier.", cmd, false);
+    TCLAP::SwitchArg trackArg("", "track", "Follow plates across the frames of videos, webcams, and streams.  Plates that have been read consistently aren't read again in every frame, and a single consolidated result is printed for each plate when it leaves the frame.  Can't be used with --pipeline.", cmd, false);
+    TCLAP::SwitchArg pipelineArg("", "pipeline", "Process video files and webcams with a separate capture thread, a bounded frame queue, and one or more recognition workers.", cmd, false);
+    TCLAP::ValueArg<int> workersArg("", "workers", "Number of recognition workers used in pipeline mode, or when several webcams and streams are analyzed at once.  Default=1", false, 1, "worker_count");
+    TCLAP::ValueArg<double> maxFpsArg("", "max_fps", "Maximum number of frames analyzed per second of video, or per second from each webcam or stream when several are analyzed at once.  0 means no limit.  Default=0", false, 0, "fps");
+    TCLAP::ValueArg<int> everyArg("", "every", "Only analyze every Nth frame of video files.  The frames in between are skipped without being decoded.  Default=1", false, 1, "N");
+    TCLAP::ValueArg<int> fullScanIntervalArg("", "full_scan_interval", "Only search the entire frame (or the entire area with motion) of videos, webcams, and streams every Nth analyzed frame, and whenever the scene changes.  The frames in between only search around the plates found in the previous frame and any motion.  Default=1", false, 1, "N");
+    TCLAP::ValueArg<float> scanWindowArg("", "scan_window", "How far the area searched around each plate between full scans extends past the plate on every side, as a multiple of its size.  Default=1", false, 1.0, "multiple");
+    TCLAP::ValueArg<int> startArg("", "start_ms", "Time in milliseconds at which to start analyzing video files.  Default=0", false, 0, "milliseconds");
+    TCLAP::ValueArg<int> endArg("", "end_ms", "Time in milliseconds at which to stop analyzing video files, or 0 to analyze until the end.  Default=0", false, 0, "milliseconds");
+    TCLAP::ValueArg<int> queueSizeArg("", "queue_size", "Maximum number of frames waiting for recognition in pipeline mode.  Default=8", false, 8, "frame_count");
+    std::vector<std::string> dropPolicies;
+    dropPolicies.push_back("oldest");
+    dropPolicies.push_back("block");
+    TCLAP::ValuesConstraint<std::string> dropPolicyConstraint(dropPolicies);
+    TCLAP::ValueArg<int> threadsArg("", "threads", "Number of workers used to analyze image files and directories in parallel.  Results are still printed in input order.  Default=1", false, 1, "thread_count");
+    std::vector<std::string> frameFormats;
+    frameFormats.push_back("jpg");
+    frameFormats.push_back("raw");
+    TCLAP::ValuesConstraint<std::string> frameFormatConstraint(frameFormats);
+    TCLAP::ValueArg<std::string> frameFormatArg("", "frame_format", "Format used to save analyzed frames to /dev/shm: compressed JPEG, or uncompressed PPM/PGM, which is much faster to write.  Default=jpg", false, "jpg", &frameFormatConstraint);
+    TCLAP::ValueArg<int> jpegQualityArg("", "jpeg_quality", "JPEG quality (1-100) used to save analyzed frames.  Default=95", false, 95, "quality");
+    TCLAP::ValueArg<int> frameMaxAgeArg("", "frame_max_age", "Number of seconds frames saved with --save_frames are kept before they are deleted.  Default=10", false, 10, "seconds");
+    TCLAP::ValueArg<int> frameMaxCountArg("", "frame_max_count", "Maximum number of frames saved with --save_frames that are kept at once, or 0 for no limit.  Default=0", false, 0, "frame_count");
+    TCLAP::ValueArg<std::string> shmRingArg("", "shm_ring", "Copy each analyzed frame (as raw pixels) and its JSON results into a shared memory ring buffer at /dev/shm/<name>, keyed by the result identifier.", false, "", "name");
+    TCLAP::ValueArg<int> shmRingSlotsArg("", "shm_ring_slots", "Number of frames kept in the shared memory ring buffer.  Default=8", false, 8, "slot_count");
+    TCLAP::SwitchArg flushEachArg("", "flush_each", "Write out each result as soon as it is available.  This is the default when the output is a terminal.", cmd, false);
+    TCLAP::ValueArg<int> flushIntervalArg("", "flush_interval", "Maximum number of milliseconds results are held back, when the output is collected and written out in batches.  0 writes out each result as soon as it is available.  Default=200", false, 200, "milliseconds");
+    TCLAP::ValueArg<int> statsIntervalArg("", "stats_interval", "Print a line of JSON to stderr every N seconds with the time spent in each stage of the analysis and the number of plate candidates found, disqualified, and read since the previous line.  0 means never.  Default=0", false, 0, "seconds");
+    TCLAP::ValueArg<std::string> dropPolicyArg("", "drop_policy", "What to do when the frame queue is full in pipeline mode: drop the oldest frame, or block the capture thread.  Default=block", false, "block", &dropPolicyConstraint);
 
     try {
         cmd.add( topNArg );
         cmd.add( fileArg );
         cmd.add( countryCodeArg );
+        cmd.add( workersArg );
+        cmd.add( maxFpsArg );
+        cmd.add( everyArg );
+        cmd.add( fullScanIntervalArg );
+        cmd.add( scanWindowArg );
+        cmd.add( startArg );
+        cmd.add( endArg );
+        cmd.add( queueSizeArg );
+        cmd.add( dropPolicyArg );
+        cmd.add( threadsArg );
+        cmd.add( frameFormatArg );
+        cmd.add( jpegQualityArg );
+        cmd.add( frameMaxAgeArg );
+        cmd.add( frameMaxCountArg );
+        cmd.add( shmRingArg );
+        cmd.add( shmRingSlotsArg );
+        cmd.add( flushIntervalArg );
+        cmd.add( statsIntervalArg );
 
         if (cmd.parse( argc, argv ) == false) {
             // Error occurred while parsing. Exit now.
@@ -149,19 +337,45 @@ int main(int argc, const char** argv) {
         topn = topNArg.getValue();
         do_motiondetection = motiondetect.getValue();
         save_each_frame = saveframes.getValue();
+        use_pipeline = pipelineArg.getValue();
+        track_plates = trackArg.getValue();
+        pipeline_workers = std::max(workersArg.getValue(), 1);
+        max_fps = std::max(maxFpsArg.getValue(), 0.0);
+        every = std::max(everyArg.getValue(), 1);
+        full_scan_interval = std::max(fullScanIntervalArg.getValue(), 1);
+        scan_window = std::max(scanWindowArg.getValue(), 0.0f);
+        seektoms = std::max(startArg.getValue(), 0);
+        end_ms = std::max(endArg.getValue(), 0);
+        queue_size = std::max(queueSizeArg.getValue(), 1);
+        drop_policy = (dropPolicyArg.getValue() == "oldest") ? QUEUE_DROP_OLDEST : QUEUE_BLOCK;
+        batch_threads = std::max(threadsArg.getValue(), 1);
+        frame_format = (frameFormatArg.getValue() == "raw") ? FRAME_SINK_RAW : FRAME_SINK_JPEG;
+        jpeg_quality = std::min(std::max(jpegQualityArg.getValue(), 1), 100);
+        frame_max_age = std::max(frameMaxAgeArg.getValue(), 0);
+        frame_max_count = std::max(frameMaxCountArg.getValue(), 0);
+        shm_ring_name = shmRingArg.getValue();
+        shm_ring_slots = std::max(shmRingSlotsArg.getValue(), 1);
+        flush_each = flushEachArg.getValue() || isatty(fileno(stdout));
+        flush_interval = std::max(flushIntervalArg.getValue(), 0);
+        stats_interval = std::max(statsIntervalArg.getValue(), 0);
     } catch (TCLAP::ArgException &e) {
         std::cerr << "{\"error\": \"" << e.error() << " for arg " << e.argId() << "\"}" << std::endl;
         return 1;
     }
 
+    if (use_pipeline && track_plates) { // The pipeline workers analyze frames out of order, so plates can't be followed from one frame to the next.
+        std::cerr << "{\"error\": \"--track can't be used with --pipeline\"}" << std::endl;
+        return 1;
+    }
+
 
     cv::Mat frame;
 
+    detection_scheduler.setSchedule(full_scan_interval, scan_window);
+
     Alpr alpr(country, configFile);
     alpr.setTopN(topn);
 
-    alpr.getConfig()->setDebug(false);
-
     alpr.setDetectRegion(true);
 
     if (alpr.isLoaded() == false) {
@@ -169,38 +383,122 @@ int main(int argc, const char** argv) {
         return 1;
     }
 
+    alpr.getConfig()->setDebug(false);
+    alpr.applyConfig(); // Apply the configuration change to every loaded country.
+
+    // When several live sources are given, they are analyzed together by a shared set of workers, since each of them would otherwise run forever.
+    std::vector<std::string> live_sources;
+    for (unsigned int i = 0; i < filenames.size(); i++) {
+        if (is_webcam(filenames[i]) || is_network_stream(filenames[i])) {
+            live_sources.push_back(filenames[i]);
+        }
+    }
+    bool multi_stream = (live_sources.size() > 1);
+
+    // Every pipeline, batch, or stream worker shares the same Phantom instance, so the models are only loaded once.
+    if (!use_pipeline && !multi_stream) {
+        pipeline_workers = 1;
+    }
+    std::vector<Alpr*> pipeline_alprs(pipeline_workers, &alpr);
+    std::vector<Alpr*> batch_alprs(batch_threads, &alpr);
+    std::vector<std::string> batch_files; // Image files waiting to be analyzed by the batch workers.
+
+    const char* frame_directory = "/dev/shm/phantomalpr"; // This is the directory where each individual still frame will be saved.
     if (save_each_frame) { // If individual frame-saving is enabled, then initialize the corresponding output directory.
-        const char* frame_directory = "/dev/shm/phantomalpr"; // This is the directory where each individual still frame will be saved.
         mode_t permissions = 0777; // Set permissions to read, write, and execute for everyone.
         makePath(frame_directory, permissions); // Create the directory.
     }
 
+    // Saved frames are tracked as they are written, so that expired frames can be deleted without scanning the directory every frame.
+    FrameRetention retention(frame_directory, frame_max_age, frame_max_count);
+    if (DirectoryExists(frame_directory)) {
+        retention.sweep(); // Remove frames left behind by previous runs.
+    }
+
+    // Frames are encoded and written by a background thread, so that saving them doesn't slow down recognition.
+    FrameSink sink("/dev/shm/phantom-webcam", frame_directory, frame_format, jpeg_quality, &retention);
+    frame_sink = &sink;
+
+    // Results are collected and written out in batches, unless they are being watched live.
+    ResultWriter writer(stdout, flush_each, OUTPUT_BUFFER_SIZE, flush_interval);
+    result_writer = &writer;
+
+    // The statistics are printed by a background thread, so they keep coming even while a live source has no motion.
+    StatsState stats;
+    if (stats_interval > 0) {
+        Alpr::getStats(true); // Leave out the time spent loading.
+        stats.interval = stats_interval;
+        stats.active = true;
+        stats.thread = new tthread::thread(stats_thread, (void*) &stats);
+    }
+
 
     for (unsigned int i = 0; i < filenames.size(); i++) { // Iterate through all of the file names supplied.
         std::string filename = filenames[i];
 
-        if (filename == "webcam" || startsWith(filename, WEBCAM_PREFIX)) { // Handle webcam video streams.
-            int webcamnumber = 0;
-      
-            // Parse the webcam device number.
-            if(startsWith(filename, WEBCAM_PREFIX) && filename.length() > WEBCAM_PREFIX.length()) { 
-                webcamnumber = atoi(filename.substr(WEBCAM_PREFIX.length()).c_str());
+        if (!program_active) { // Check to see if the user stopped the program while a live source was being analyzed.
+            break;
+        }
+
+        if (multi_stream && (is_webcam(filename) || is_network_stream(filename))) { // Live sources are analyzed together after every other file.
+            continue;
+        }
+
+        if (batch_threads > 1) { // Check to see if images should be analyzed in parallel.
+            if (is_supported_image(filename)) {
+                batch_files.push_back(filename);
+                continue;
+            } else if (DirectoryExists(filename.c_str())) {
+                std::vector<std::string> files = getFilesInDir(filename.c_str());
+                std::sort(files.begin(), files.end(), stringCompare);
+                for (unsigned int f = 0; f < files.size(); f++) {
+                    if (is_supported_image(files[f])) {
+                        batch_files.push_back(filename + "/" + files[f]);
+                    }
+                }
+                continue;
+            } else if (batch_files.size() > 0) { // Finish the images queued so far, so results stay in input order.
+                run_batch(batch_files, batch_alprs);
+                batch_files.clear();
+            }
+        }
+
+        if (is_webcam(filename)) { // Handle webcam video streams.
+            if (use_pipeline) {
+                int webcamnumber = 0;
+          
+                // Parse the webcam device number.
+                if(startsWith(filename, WEBCAM_PREFIX) && filename.length() > WEBCAM_PREFIX.length()) { 
+                    webcamnumber = atoi(filename.substr(WEBCAM_PREFIX.length()).c_str());
+                }
+          
+                cv::VideoCapture cap(webcamnumber);
+                if (!cap.isOpened()) {
+                    std::cerr << "{\"error\": \"Error opening webcam\"}" << std::endl;
+                    return 1;
+                }
+                run_pipeline(cap, pipeline_alprs, queue_size, drop_policy);
+                continue;
             }
-      
-            int framenum = 0;
-            cv::VideoCapture cap(webcamnumber);
-            if (!cap.isOpened()) {
+
+            if (!run_live(live_source(filename), &alpr)) {
                 std::cerr << "{\"error\": \"Error opening webcam\"}" << std::endl;
                 return 1;
             }
-      
-            while (cap.read(frame)) {
-                if (framenum == 0) {
-                    motiondetector.ResetMotionDetection(&frame);
+        } else if (is_network_stream(filename)) { // Handle network video streams.
+            if (use_pipeline) {
+                cv::VideoCapture cap(filename);
+                if (!cap.isOpened()) {
+                    std::cerr << "{\"error\": \"Error opening stream: " << filename << "\"}" << std::endl;
+                    return 1;
                 }
-                detectandshow(&alpr, frame, "", save_each_frame);
-                sleep_ms(10);
-                framenum++;
+                run_pipeline(cap, pipeline_alprs, queue_size, drop_policy);
+                continue;
+            }
+
+            if (!run_live(filename, &alpr)) {
+                std::cerr << "{\"error\": \"Error opening stream: " << filename << "\"}" << std::endl;
+                return 1;
             }
         } else if (is_supported_video(filename)) { // Handle video files.
             if (fileExists(filename.c_str())) {
@@ -208,19 +506,41 @@ int main(int argc, const char** argv) {
 
                 cv::VideoCapture cap = cv::VideoCapture();
                 cap.open(filename);
-                cap.set(cv::CAP_PROP_POS_MSEC, seektoms);
+                if (seektoms > 0) {
+                    cap.set(cv::CAP_PROP_POS_MSEC, seektoms);
+                }
+                VideoDecimation decimation = init_decimation(cap, every, max_fps, seektoms, end_ms);
 
-                while (cap.read(frame)) {
+                if (use_pipeline) {
+                    run_pipeline(cap, pipeline_alprs, queue_size, drop_policy, &decimation);
+                    continue;
+                }
+
+                PlateTracker tracker;
+                while (read_decimated_frame(cap, frame, decimation)) {
                     if (SAVE_LAST_VIDEO_STILL) {
                         cv::imwrite(LAST_VIDEO_STILL_LOCATION, frame);
                     }
               
-                    if (framenum == 0)
+                    if (framenum == 0) {
                         motiondetector.ResetMotionDetection(&frame);
-                    detectandshow(&alpr, frame, "", save_each_frame);
-                    sleep_ms(1); // Create a 1 millisecond delay.
+                        detection_scheduler.reset();
+                    }
+                    if (track_plates) {
+                        std::vector<AlprRegionOfInterest> regionsOfInterest = get_regions_of_interest(frame, motiondetector, &detection_scheduler);
+                        AlprResults results = recognize_frame(&alpr, frame, regionsOfInterest, &tracker);
+                        detection_scheduler.update(results);
+                        output_results(results, frame, regionsOfInterest.size() > 0, save_each_frame);
+                        output_tracks(&tracker, -1);
+                    } else {
+                        detectandshow(&alpr, frame, "", save_each_frame, &detection_scheduler);
+                    }
                     framenum++;
                 }
+                if (track_plates) { // Report the plates that were still in view at the end of the video.
+                    tracker.endAllTracks();
+                    output_tracks(&tracker, -1);
+                }
             } else {
                 std::cerr << "{\"error\": \"Video file not found: " << filename << "\"}" << std::endl;
             }
@@ -231,7 +551,7 @@ int main(int argc, const char** argv) {
                 bool plate_found = detectandshow(&alpr, frame, "", save_each_frame);
 
             } else {
-                std::cout << "{\"error\": \"Image file not found: " << filename << "\"}" << std::endl;
+                result_writer->write("{\"error\": \"Image file not found: " + filename + "\"}");
             }
 
         } else if (DirectoryExists(filename.c_str())) { // Handle directories.
@@ -242,8 +562,8 @@ int main(int argc, const char** argv) {
             for (int i = 0; i < files.size(); i++) {
                 if (is_supported_image(files[i])) {
                     std::string fullpath = filename + "/" + files[i];
-                    std::cout << fullpath << std::endl;
                     frame = cv::imread(fullpath.c_str());
+                    detectandshow(&alpr, frame, "", save_each_frame);
                 }
             }
 
@@ -253,13 +573,25 @@ int main(int argc, const char** argv) {
         }
     }
 
+    if (batch_files.size() > 0) {
+        run_batch(batch_files, batch_alprs);
+    }
+
+    if (multi_stream && program_active) {
+        run_streams(live_sources, pipeline_alprs, max_fps);
+    }
+
+    if (stats_interval > 0) {
+        stats.stop();
+        print_stats(); // Cover the time since the last periodic line.
+    }
+
     return 0;
 }
 
 
 
 
-
 bool is_supported_video(std::string file_name) {
     return (hasEndingInsensitive(file_name, ".avi") || hasEndingInsensitive(file_name, ".mp4") || hasEndingInsensitive(file_name, ".webm") || hasEndingInsensitive(file_name, ".flv") || hasEndingInsensitive(file_name, ".mjpg") || hasEndingInsensitive(file_name, ".mjpeg") || hasEndingInsensitive(file_name, ".mkv") || hasEndingInsensitive(file_name, ".m4v") || hasEndingInsensitive(file_name, ".ts"));
 }
@@ -268,43 +600,599 @@ bool is_supported_image(std::string file_name) {
     return (hasEndingInsensitive(file_name, ".png") || hasEndingInsensitive(file_name, ".jpg") || hasEndingInsensitive(file_name, ".tif") || hasEndingInsensitive(file_name, ".bmp") ||  hasEndingInsensitive(file_name, ".jpeg") || hasEndingInsensitive(file_name, ".gif"));
 }
 
-bool detectandshow(Alpr* alpr, cv::Mat frame, std::string region, bool save_each_frame) {
+bool is_webcam(std::string file_name) {
+    return (file_name == "webcam" || startsWith(file_name, WEBCAM_PREFIX));
+}
+
+// This function returns the address the video buffer should connect to for a webcam or network stream.
+std::string live_source(std::string file_name) {
+    if (file_name == "webcam") {
+        return WEBCAM_PREFIX + "0";
+    }
+    return file_name;
+}
+
+bool is_network_stream(std::string file_name) {
+    return (startsWith(file_name, "http://") || startsWith(file_name, "https://") || startsWith(file_name, "rtsp://"));
+}
+
+bool detectandshow(Alpr* alpr, cv::Mat frame, std::string region, bool save_each_frame, DetectionScheduler* scheduler) {
     // Get the time that the analysis started:
     timespec startTime;
     getTimeMonotonic(&startTime);
 
 
-    std::vector<AlprRegionOfInterest> regionsOfInterest;
+    std::vector<AlprRegionOfInterest> regionsOfInterest = get_regions_of_interest(frame, motiondetector, scheduler);
+
+    AlprResults results = recognize_frame(alpr, frame, regionsOfInterest);
+    if (scheduler != NULL) {
+        scheduler->update(results);
+    }
+
+
+    // Get the time that the analysis finished:
+    timespec endTime;
+    getTimeMonotonic(&endTime);
+
+    // Calculate the total processing time based on the start time and end time:
+    double totalProcessingTime = diffclock(startTime, endTime);
+
+    output_results(results, frame, regionsOfInterest.size() > 0, save_each_frame);
+
+    return results.plates.size() > 0; // Return 'true' if plates were detected.
+}
+
+// This function determines which areas of the frame should be analyzed, based on motion detection if it is enabled.  For frames of a video, the scheduler may narrow them down to the areas around the plates found in the previous frame.
+std::vector<AlprRegionOfInterest> get_regions_of_interest(cv::Mat& frame, MotionDetector& detector, DetectionScheduler* scheduler) {
+    std::vector<cv::Rect> regions;
     if (do_motiondetection) {
-        cv::Rect rectan = motiondetector.MotionDetect(&frame);
+        cv::Rect rectan = detector.MotionDetect(&frame);
         if (rectan.width > 0) {
-            regionsOfInterest.push_back(AlprRegionOfInterest(rectan.x, rectan.y, rectan.width, rectan.height));
+            regions.push_back(rectan);
         }
     } else {
-        regionsOfInterest.push_back(AlprRegionOfInterest(0, 0, frame.cols, frame.rows));
+        regions.push_back(cv::Rect(0, 0, frame.cols, frame.rows));
+    }
+
+    if (scheduler != NULL) {
+        regions = scheduler->schedule(frame, regions, do_motiondetection);
+    }
+
+    std::vector<AlprRegionOfInterest> regionsOfInterest;
+    for (unsigned int i = 0; i < regions.size(); i++) {
+        regionsOfInterest.push_back(AlprRegionOfInterest(regions[i].x, regions[i].y, regions[i].width, regions[i].height));
     }
+    return regionsOfInterest;
+}
 
+// This function runs the recognition on a frame.  Frames without any regions of interest aren't analyzed, and return empty results.  When a tracker is given, plates it is already following may reuse their earlier read.
+AlprResults recognize_frame(Alpr* alpr, cv::Mat frame, std::vector<AlprRegionOfInterest> regionsOfInterest, PlateTracker* tracker) {
     AlprResults results;
     if (regionsOfInterest.size() > 0) {
-        results = alpr->recognize(frame.data, frame.elemSize(), frame.cols, frame.rows, regionsOfInterest);
-        remove_old_files("/dev/shm/phantomalpr/", 10); // Remove all frames older than 10 seconds.
+        if (tracker != NULL) {
+            results = tracker->recognize(alpr, frame.data, frame.elemSize(), frame.cols, frame.rows, regionsOfInterest);
+        } else {
+            results = alpr->recognize(frame.data, frame.elemSize(), frame.cols, frame.rows, regionsOfInterest);
+        }
+    }
+    return results;
+}
+
+// This function prints a consolidated result for each plate that has left the frame since the last call.
+void output_tracks(PlateTracker* tracker, int stream_id) {
+    std::vector<AlprTrack> tracks = tracker->finishedTracks();
+    for (unsigned int i = 0; i < tracks.size(); i++) {
+        tracks[i].stream_id = stream_id;
+        result_writer->write(PlateTracker::toJson(tracks[i]));
+    }
+}
+
+// This function publishes the results of an analysis by saving the frame for other programs and printing the results in JSON format.
+void output_results(AlprResults& results, cv::Mat frame, bool analyzed, bool save_each_frame) {
+    prepare_output(results, frame, analyzed, save_each_frame);
+    frame_sink->waitUntilWritten(save_each_frame ? results.identifier : ""); // The frame file has to exist before a consumer sees its identifier.
+    Alpr::toJson(results, result_writer->beginLine()); // Print the analysis results in JSON format, serialized directly into the output buffer.
+    result_writer->endLine();
+}
+
+// This function saves the analyzed frame for other programs before its results are printed.
+void prepare_output(AlprResults& results, cv::Mat frame, bool analyzed, bool save_each_frame) {
+    if (analyzed) {
         results.identifier = random_string(12); // Assign a random identifier to this set of results.
-        imwrite("/dev/shm/phantom-webcam.jpg", frame); // Save the captured frame to memory so other program's can access it.
-        if (save_each_frame) {
-            imwrite("/dev/shm/phantomalpr/" + results.identifier + ".jpg", frame);
+        frame_sink->submit(frame, save_each_frame ? results.identifier : ""); // Save the captured frame to memory so other program's can access it.
+    }
+
+    if (analyzed && shm_ring_name.length() > 0) {
+        write_shm_ring(frame, results); // This happens before the results are printed, so the frame is already available when a consumer sees the identifier.
+    }
+}
+
+// This function copies an analyzed frame and its results into the shared memory ring buffer.  The ring is created when the first frame arrives, with slots sized to fit that frame.
+void write_shm_ring(cv::Mat& frame, AlprResults& results) {
+    tthread::lock_guard<tthread::mutex> guard(shm_ring_mutex);
+
+    if (!shm_ring.isOpen()) {
+        uint64_t frame_capacity = (uint64_t) frame.cols * frame.rows * frame.elemSize();
+        if (!shm_ring.create(shm_ring_name, shm_ring_slots, frame_capacity, SHM_RING_RESULTS_CAPACITY)) {
+            shm_ring_name = ""; // Disable the ring buffer, rather than trying again on every frame.
+            return;
         }
     }
 
+    shm_ring_json.clear();
+    Alpr::toJson(results, shm_ring_json);
+    if (!shm_ring.write(frame, results.identifier, results.epoch_time, shm_ring_json) && shm_ring.rejected() == 1) { // Only report the first frame that didn't fit.
+        std::cerr << "{\"error\": \"Frame is too large for the shared memory ring buffer\"}" << std::endl;
+    }
+}
 
-    // Get the time that the analysis finished:
-    timespec endTime;
-    getTimeMonotonic(&endTime);
 
-    // Calculate the total processing time based on the start time and end time:
-    double totalProcessingTime = diffclock(startTime, endTime);
 
-    std::cout << alpr->toJson(results) << std::endl; // Print the analysis results in JSON format.
+// This function works out which frames of a video file should be analyzed, based on the --every and --max_fps options and the time window.
+VideoDecimation init_decimation(cv::VideoCapture& cap, int every, double max_fps, int start_ms, int end_ms) {
+    VideoDecimation decimation;
+    decimation.step = every;
+    decimation.next_frame = 0;
+    decimation.frame_index = 0;
+    decimation.start_ms = start_ms;
+    decimation.end_ms = end_ms;
 
-    return results.plates.size() > 0; // Return 'true' if plates were detected.
+    double fps = cap.get(cv::CAP_PROP_FPS);
+    decimation.frame_ms = (fps > 0) ? 1000.0 / fps : 0;
+    if (max_fps > 0 && fps > max_fps) { // Check to see if the frame rate of the file is higher than the cap.
+        decimation.step = std::max(decimation.step, fps / max_fps);
+    }
+    return decimation;
 }
 
+// This function reads the next frame that should be analyzed.  Frames that are skipped are only grabbed, and never decoded.  Returns false at the end of the file or time window.
+bool read_decimated_frame(cv::VideoCapture& cap, cv::Mat& frame, VideoDecimation& decimation) {
+    while (true) {
+        if (decimation.end_ms > 0) { // Check to see if the end of the time window has been reached.
+            double position_ms = (decimation.frame_ms > 0) ? decimation.start_ms + decimation.frame_index * decimation.frame_ms : cap.get(cv::CAP_PROP_POS_MSEC);
+            if (position_ms >= decimation.end_ms) {
+                return false;
+            }
+        }
+
+        if (!cap.grab()) {
+            return false;
+        }
+        int64_t index = decimation.frame_index++;
+
+        if (index + 0.000001 >= decimation.next_frame) { // Check to see if this frame is due to be analyzed.
+            decimation.next_frame += decimation.step;
+            return cap.retrieve(frame);
+        }
+    }
+}
+
+// This function reads frames from the video capture, and queues them for the recognition workers.
+void pipeline_capture_thread(void* arg) {
+    PipelineState* state = (PipelineState*) arg;
+
+    int64_t framenum = 0;
+    while (program_active) {
+        PipelineFrame item;
+        bool captured = (state->decimation != NULL) ? read_decimated_frame(*state->cap, item.frame, *state->decimation) : state->cap->read(item.frame);
+        if (!captured) {
+            break;
+        }
+
+        if (framenum == 0) {
+            motiondetector.ResetMotionDetection(&item.frame);
+            detection_scheduler.reset();
+        }
+        item.frame_number = framenum++;
+        item.regionsOfInterest = get_regions_of_interest(item.frame, motiondetector, &detection_scheduler);
+        item.dropped = false;
+
+        PipelineFrame dropped_item;
+        if (state->frames->push(item, dropped_item)) { // Check to see if the queue was full, and the oldest frame was discarded.
+            dropped_item.dropped = true;
+            dropped_item.frame.release();
+            state->results->push(dropped_item); // Let the output stage know that this frame will never be analyzed.
+        }
+    }
+
+    tthread::lock_guard<tthread::mutex> guard(state->mutex);
+    state->frames_captured = framenum;
+    state->frames->close(); // Let the workers know that no more frames are coming.
+}
+
+// This function analyzes queued frames until the capture thread is finished.
+void pipeline_worker_thread(void* arg) {
+    PipelineWorker* worker = (PipelineWorker*) arg;
+    PipelineState* state = worker->state;
+
+    PipelineFrame item;
+    while (state->frames->pop(item)) {
+        item.results = recognize_frame(worker->alpr, item.frame, item.regionsOfInterest);
+        state->results->push(item);
+    }
+
+    tthread::lock_guard<tthread::mutex> guard(state->mutex);
+    state->active_workers--;
+    if (state->active_workers == 0) { // Check to see if this was the last worker to finish.
+        state->results->close();
+    }
+}
+
+// This function processes a video capture with a capture thread feeding a bounded queue, one recognition worker per Phantom instance, and an output stage running on the calling thread.
+void run_pipeline(cv::VideoCapture& cap, std::vector<Alpr*> alprs, size_t queue_size, QueueDropPolicy drop_policy, VideoDecimation* decimation) {
+    SafeQueue<PipelineFrame> frames(queue_size, drop_policy);
+    SafeQueue<PipelineFrame> results;
+
+    PipelineState state;
+    state.cap = &cap;
+    state.decimation = decimation;
+    state.frames = &frames;
+    state.results = &results;
+    state.frames_captured = 0;
+    state.active_workers = alprs.size();
+
+    catch_stop_signals(true); // CTRL+C stops the capture thread, and the frames already queued are still analyzed and printed.
+
+    std::vector<PipelineWorker> workers(alprs.size());
+    std::vector<tthread::thread*> threads;
+    for (unsigned int i = 0; i < alprs.size(); i++) {
+        workers[i].state = &state;
+        workers[i].alpr = alprs[i];
+        threads.push_back(new tthread::thread(pipeline_worker_thread, (void*) &workers[i]));
+    }
+    threads.push_back(new tthread::thread(pipeline_capture_thread, (void*) &state));
+
+    // Workers can finish out of order, so hold on to the results until every earlier frame has been published.
+    std::map<int64_t, PipelineFrame> pending;
+    int64_t next_frame = 0;
+    PipelineFrame item;
+    while (results.pop(item)) {
+        pending[item.frame_number] = item;
+        while (!pending.empty() && pending.begin()->first == next_frame) {
+            PipelineFrame& ready = pending.begin()->second;
+            if (!ready.dropped) {
+                detection_scheduler.update(ready.results); // The capture thread is usually a few frames ahead, so the windows around the plates lag behind slightly.
+                output_results(ready.results, ready.frame, ready.regionsOfInterest.size() > 0, save_each_frame);
+            }
+            pending.erase(pending.begin());
+            next_frame++;
+        }
+    }
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    catch_stop_signals(false);
+
+    std::cerr << "{\"pipeline\": {\"frames_captured\": " << state.frames_captured << ", \"frames_dropped\": " << frames.dropped() << "}}" << std::endl;
+}
+
+
+
+// This function analyzes a live source (a webcam or network stream).  A background thread keeps reading from the source, and each analysis takes the most recent frame, so frames that arrive while recognition is running are skipped instead of building up behind it.  Runs until the user stops the program.  Returns false if the source couldn't be opened.
+bool run_live(std::string source, Alpr* alpr) {
+    VideoBuffer video_buffer;
+    video_buffer.connect(source, 0);
+    if (!video_buffer.waitForConnection()) {
+        video_buffer.disconnect();
+        return false;
+    }
+    catch_stop_signals(true);
+
+    PlateTracker tracker;
+    int last_frame_number = -1;
+    int64_t frames_analyzed = 0;
+    int64_t frames_skipped = 0;
+    while (program_active) {
+        cv::Mat frame;
+        std::vector<cv::Rect> buffer_regions; // The video buffer always returns the full frame, so motion detection is handled below instead.
+        int frame_number = video_buffer.getLatestFrame(&frame, buffer_regions); // Poll rather than block, so that a stop request is noticed even while the source is reconnecting.
+        if (frame_number < 0) { // Check to see if the video buffer was disconnected, or hasn't received a new frame yet.
+            if (!video_buffer.isConnected()) {
+                break;
+            }
+            sleep_ms(2);
+            continue;
+        }
+
+        if (last_frame_number < 0) {
+            motiondetector.ResetMotionDetection(&frame);
+            detection_scheduler.reset();
+        }
+
+        std::vector<AlprRegionOfInterest> regionsOfInterest = get_regions_of_interest(frame, motiondetector, &detection_scheduler);
+        AlprResults results = recognize_frame(alpr, frame, regionsOfInterest, track_plates ? &tracker : NULL);
+        detection_scheduler.update(results);
+        results.frame_number = frame_number;
+        results.frames_skipped = (last_frame_number < 0) ? 0 : frame_number - last_frame_number - 1;
+        output_results(results, frame, regionsOfInterest.size() > 0, save_each_frame);
+        output_tracks(&tracker, -1);
+
+        frames_skipped += results.frames_skipped;
+        frames_analyzed++;
+        last_frame_number = frame_number;
+    }
+
+    catch_stop_signals(false);
+    video_buffer.disconnect();
+    tracker.endAllTracks();
+    output_tracks(&tracker, -1);
+
+    std::cerr << "{\"live\": {\"frames_analyzed\": " << frames_analyzed << ", \"frames_skipped\": " << frames_skipped << "}}" << std::endl;
+    return true;
+}
+
+
+
+// This function orders streams by the time they became due, so the stream that has waited the longest comes first.
+bool stream_due_before(const LiveStream* a, const LiveStream* b) {
+    return a->next_due_ms < b->next_due_ms;
+}
+
+// This function picks the next stream for a worker to analyze, and takes its latest frame.  Among the streams that have a new frame and aren't held back by their frame rate cap, the one that has been waiting the longest is served first.  Returns NULL if no stream is ready.
+LiveStream* take_stream_frame(StreamState* state, cv::Mat& frame, int& frame_number) {
+    tthread::lock_guard<tthread::mutex> guard(state->mutex);
+    int64_t now = getEpochTimeMs();
+
+    std::vector<LiveStream*> ready;
+    for (unsigned int i = 0; i < state->streams.size(); i++) {
+        LiveStream* stream = state->streams[i];
+        if (!stream->busy && stream->next_due_ms <= now) {
+            ready.push_back(stream);
+        }
+    }
+    std::stable_sort(ready.begin(), ready.end(), stream_due_before);
+
+    for (unsigned int i = 0; i < ready.size(); i++) {
+        std::vector<cv::Rect> buffer_regions; // The video buffer always returns the full frame, so motion detection is handled by the worker instead.
+        frame_number = ready[i]->buffer->getLatestFrame(&frame, buffer_regions);
+        if (frame_number >= 0) {
+            ready[i]->busy = true;
+            ready[i]->next_due_ms = now + state->min_interval_ms;
+            return ready[i];
+        }
+    }
+    return NULL;
+}
+
+// This function checks whether every stream has been disconnected (because it couldn't be opened).  A disconnected stream has no frames left to take.
+bool all_streams_ended(StreamState* state) {
+    tthread::lock_guard<tthread::mutex> guard(state->mutex);
+    for (unsigned int i = 0; i < state->streams.size(); i++) {
+        if (state->streams[i]->busy || state->streams[i]->buffer->isConnected()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// This function analyzes frames from whichever stream is due next, until the program is stopped or every stream has ended.
+void stream_worker_thread(void* arg) {
+    StreamWorker* worker = (StreamWorker*) arg;
+    StreamState* state = worker->state;
+
+    while (program_active) {
+        cv::Mat frame;
+        int frame_number;
+        LiveStream* stream = take_stream_frame(state, frame, frame_number);
+        if (stream == NULL) { // Check to see if every stream is either busy, capped, or waiting for a new frame.
+            if (all_streams_ended(state)) {
+                break;
+            }
+            sleep_ms(2);
+            continue;
+        }
+
+        if (stream->last_frame_number < 0) {
+            stream->motion.ResetMotionDetection(&frame);
+        }
+
+        std::vector<AlprRegionOfInterest> regionsOfInterest = get_regions_of_interest(frame, stream->motion, &stream->scheduler);
+        AlprResults results = recognize_frame(worker->alpr, frame, regionsOfInterest, track_plates ? &stream->tracker : NULL);
+        stream->scheduler.update(results);
+        results.frame_number = frame_number;
+        results.stream_id = stream->stream_id;
+        results.frames_skipped = (stream->last_frame_number < 0) ? 0 : frame_number - stream->last_frame_number - 1;
+
+        {
+            tthread::lock_guard<tthread::mutex> guard(state->output_mutex);
+            output_results(results, frame, regionsOfInterest.size() > 0, save_each_frame);
+            output_tracks(&stream->tracker, stream->stream_id);
+        }
+
+        tthread::lock_guard<tthread::mutex> guard(state->mutex);
+        stream->frames_skipped += results.frames_skipped;
+        stream->frames_analyzed++;
+        stream->last_frame_number = frame_number;
+        stream->busy = false;
+    }
+}
+
+// This function analyzes several live sources at once.  Each source has its own capture thread and motion detector, and every Phantom instance is shared between all of the sources.
+void run_streams(std::vector<std::string> sources, std::vector<Alpr*> alprs, double max_fps) {
+    StreamState state;
+    state.min_interval_ms = (max_fps > 0) ? (int64_t) (1000.0 / max_fps) : 0;
+
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        LiveStream* stream = new LiveStream();
+        stream->stream_id = i;
+        stream->source = sources[i];
+        stream->buffer = new VideoBuffer();
+        stream->busy = false;
+        stream->next_due_ms = 0;
+        stream->last_frame_number = -1;
+        stream->frames_analyzed = 0;
+        stream->frames_skipped = 0;
+        stream->scheduler.setSchedule(full_scan_interval, scan_window);
+        stream->buffer->connect(live_source(sources[i]), 0);
+        state.streams.push_back(stream);
+    }
+
+    // The streams are opened in the background, all at once.  A stream that can't be opened is left out, and the others carry on.
+    for (unsigned int i = 0; i < state.streams.size(); i++) {
+        if (!state.streams[i]->buffer->waitForConnection()) {
+            std::cerr << "{\"error\": \"Error opening stream: " << state.streams[i]->source << "\"}" << std::endl;
+            state.streams[i]->buffer->disconnect();
+        }
+    }
+
+    catch_stop_signals(true);
+
+    std::vector<StreamWorker> workers(alprs.size());
+    std::vector<tthread::thread*> threads;
+    for (unsigned int i = 0; i < alprs.size(); i++) {
+        workers[i].state = &state;
+        workers[i].alpr = alprs[i];
+        threads.push_back(new tthread::thread(stream_worker_thread, (void*) &workers[i]));
+    }
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+    catch_stop_signals(false);
+
+    std::cerr << "{\"streams\": [";
+    for (unsigned int i = 0; i < state.streams.size(); i++) {
+        LiveStream* stream = state.streams[i];
+        stream->buffer->disconnect();
+        stream->tracker.endAllTracks();
+        output_tracks(&stream->tracker, stream->stream_id);
+        std::cerr << (i > 0 ? ", " : "") << "{\"stream_id\": " << stream->stream_id << ", \"frames_analyzed\": " << stream->frames_analyzed << ", \"frames_skipped\": " << stream->frames_skipped << "}";
+        delete stream->buffer;
+        delete stream;
+    }
+    std::cerr << "]}" << std::endl;
+}
+
+
+
+// This function returns the index of the next file for a batch worker, stealing from the other workers once its own queue is empty.  Returns false when there is no work left.
+bool take_batch_job(BatchState* state, size_t worker_index, size_t& job) {
+    for (size_t i = 0; i < state->queues.size(); i++) {
+        size_t queue_index = (worker_index + i) % state->queues.size();
+        BatchQueue* queue = state->queues[queue_index];
+
+        tthread::lock_guard<tthread::mutex> guard(queue->mutex);
+        if (queue->jobs.empty()) {
+            continue;
+        }
+        if (i == 0) { // Take work from the front of this worker's own queue.
+            job = queue->jobs.front();
+            queue->jobs.pop_front();
+        } else { // Steal work from the back of another worker's queue.
+            job = queue->jobs.back();
+            queue->jobs.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+// This function analyzes batch files until every queue is empty.
+void batch_worker_thread(void* arg) {
+    BatchWorker* worker = (BatchWorker*) arg;
+    BatchState* state = worker->state;
+
+    size_t job;
+    while (take_batch_job(state, worker->index, job)) {
+        std::string filename = state->files[job];
+        std::string output;
+
+        if (fileExists(filename.c_str())) {
+            cv::Mat frame = cv::imread(filename);
+
+            // Motion detection isn't used here, since it depends on the order of the frames.
+            std::vector<AlprRegionOfInterest> regionsOfInterest;
+            regionsOfInterest.push_back(AlprRegionOfInterest(0, 0, frame.cols, frame.rows));
+
+            AlprResults results = recognize_frame(worker->alpr, frame, regionsOfInterest);
+
+            {
+                tthread::lock_guard<tthread::mutex> guard(state->publish_mutex);
+                prepare_output(results, frame, true, save_each_frame);
+            }
+            Alpr::toJson(results, output);
+            frame_sink->waitUntilWritten(save_each_frame ? results.identifier : ""); // The frame file has to exist before a consumer sees its identifier.
+        } else {
+            output = "{\"error\": \"Image file not found: " + filename + "\"}";
+        }
+
+        tthread::lock_guard<tthread::mutex> guard(state->output_mutex);
+        state->output[job].swap(output);
+        state->finished[job] = true;
+        state->output_ready.notify_all();
+    }
+}
+
+// This function analyzes a list of image files with one worker per Phantom instance, and prints the results in input order.
+void run_batch(std::vector<std::string> files, std::vector<Alpr*> alprs) {
+    BatchState state;
+    state.files = files;
+    state.output.resize(files.size());
+    state.finished.resize(files.size(), false);
+
+    // Give each worker a contiguous share of the files to start with.
+    for (unsigned int i = 0; i < alprs.size(); i++) {
+        state.queues.push_back(new BatchQueue());
+    }
+    for (size_t i = 0; i < files.size(); i++) {
+        state.queues[(i * alprs.size()) / files.size()]->jobs.push_back(i);
+    }
+
+    std::vector<BatchWorker> workers(alprs.size());
+    std::vector<tthread::thread*> threads;
+    for (unsigned int i = 0; i < alprs.size(); i++) {
+        workers[i].state = &state;
+        workers[i].alpr = alprs[i];
+        workers[i].index = i;
+        threads.push_back(new tthread::thread(batch_worker_thread, (void*) &workers[i]));
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string output;
+        {
+            tthread::lock_guard<tthread::mutex> guard(state.output_mutex);
+            while (!state.finished[i]) {
+                state.output_ready.wait(state.output_mutex);
+            }
+            output.swap(state.output[i]);
+        }
+        result_writer->write(output);
+    }
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+        delete state.queues[i];
+    }
+}
+
+// This function runs in the background, and prints the statistics collected since the previous line every stats_interval seconds, until it is stopped.
+void stats_thread(void* arg) {
+    StatsState* state = (StatsState*) arg;
+    int64_t interval_ms = (int64_t) state->interval * 1000;
+    int64_t next_ms = getTimeMonotonicMs() + interval_ms;
+    while (true) {
+        sleep_ms(100);
+        {
+            tthread::lock_guard<tthread::mutex> guard(state->mutex);
+            if (!state->active) {
+                break;
+            }
+        }
+        if (getTimeMonotonicMs() < next_ms) {
+            continue;
+        }
+        next_ms += interval_ms;
+        print_stats();
+    }
+}
+
+// This function prints the timing and counters collected since the previous call to stderr as a single line of JSON, and starts collecting them again.
+void print_stats() {
+    std::string line = "{\"stats\": " + Alpr::statsToJson(Alpr::getStats(true)) + "}\n";
+    std::cerr << line << std::flush;
+}
@@ -64,17 +64,48 @@ namespace alpr {
         return impl->recognize(pixelData, bytesPerPixel, imgWidth, imgHeight, regionsOfInterest);
     }
 
+    AlprResults Alpr::recognize(const unsigned char* pixelData, AlprPixelFormat format, int imgWidth, int imgHeight, int stride, std::vector<AlprRegionOfInterest> regionsOfInterest) {
+        AlprImage image(pixelData, format, imgWidth, imgHeight, stride);
+        image.regionsOfInterest = regionsOfInterest;
+        return impl->recognizeImage(image);
+    }
+
+    std::vector<AlprResults> Alpr::recognizeBatch(const std::vector<AlprImage>& images) {
+        return impl->recognizeBatch(images);
+    }
+
+    void Alpr::recognizeAsync(const AlprImage& image, AlprResultsCallback callback, void* userData) {
+        impl->recognizeAsync(image, callback, userData);
+    }
+
+    std::vector<AlprRegionOfInterest> Alpr::detectPlates(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest) {
+        return impl->detectPlates(pixelData, bytesPerPixel, imgWidth, imgHeight, regionsOfInterest);
+    }
+
     std::string Alpr::toJson(AlprResults results) {
         return AlprImpl::toJson(results);
     }
     std::string Alpr::toJson(AlprPlateResult result) {
         return AlprImpl::toJson(result);
     }
+    void Alpr::toJson(const AlprResults& results, std::string& buffer) {
+        AlprImpl::toJson(results, buffer);
+    }
 
     AlprResults Alpr::fromJson(std::string json) {
         return AlprImpl::fromJson(json);
     }
 
+    AlprStats Alpr::getStats(bool reset) {
+        return getStatsSnapshot(reset);
+    }
+
+    std::string Alpr::statsToJson(const AlprStats& stats) {
+        std::string json;
+        alpr::statsToJson(stats, json);
+        return json;
+    }
+
     void Alpr::setCountry(std::string country) {
         impl->setCountry(country);
     }
@@ -99,6 +130,10 @@ namespace alpr {
         impl->setDefaultRegion(region);
     }
 
+    void Alpr::setTimeBudget(int milliseconds) {
+        impl->setTimeBudget(milliseconds);
+    }
+
     bool Alpr::isLoaded() {
         return impl->isLoaded();
     }
@@ -110,4 +145,8 @@ namespace alpr {
     Config* Alpr::getConfig() {
         return impl->config;
     }
+
+    void Alpr::applyConfig() {
+        impl->applyConfig();
+    }
 }
@@ -100,6 +100,9 @@ namespace alpr {
         public:
             AlprResults() {
                 frame_number = -1;
+                frames_skipped = -1;
+                stream_id = -1;
+                truncated = false;
             };
         virtual ~AlprResults() {};
 
@@ -111,9 +114,128 @@ namespace alpr {
 
         std::string identifier; // This is a random unique identifier used to specify the frame used to determine these results.
 
+        int stream_id; // When several streams are analyzed by one process, this is the index of the stream these results came from.  -1 when not applicable.
+
+        int64_t frames_skipped; // For live sources, the number of frames that were captured but never analyzed since the previous results.  -1 when not applicable.
+
         std::vector<AlprPlateResult> plates;
 
         std::vector<AlprRegionOfInterest> regionsOfInterest;
+
+        bool truncated; // True when the time budget ran out before the image was fully analyzed.
+        std::string truncated_reason; // What was skipped because of the time budget.  Empty when not truncated.
+    };
+
+    // The layout of raw pixel data.
+    enum AlprPixelFormat {
+        ALPR_PIXEL_BGR,  // Interleaved pixels (BGR, 3 channels).
+        ALPR_PIXEL_GRAY, // A single 8-bit channel.
+        ALPR_PIXEL_NV12, // A Y plane, followed by an interleaved UV plane at half resolution with the same stride.
+        ALPR_PIXEL_I420  // A Y plane, followed by a U plane and a V plane at half resolution with half the stride.
+    };
+
+    // A single image passed to recognizeBatch().  The image data isn't copied, so it must remain valid until the batch is finished.
+    class AlprImage {
+        public:
+            AlprImage() {
+                data = 0;
+                length = 0;
+                bytesPerPixel = 0;
+                format = ALPR_PIXEL_BGR;
+                width = 0;
+                height = 0;
+                stride = 0;
+            };
+            // Encoded image data (e.g., BMP, PNG, JPG, GIF etc).
+            AlprImage(const unsigned char* encodedData, long long length) {
+                this->data = encodedData;
+                this->length = length;
+                this->bytesPerPixel = 0;
+                this->format = ALPR_PIXEL_BGR;
+                this->width = 0;
+                this->height = 0;
+                this->stride = 0;
+            };
+            // Raw pixel data.
+            AlprImage(const unsigned char* pixelData, int bytesPerPixel, int width, int height) {
+                this->data = pixelData;
+                this->length = (long long) width * height * bytesPerPixel;
+                this->bytesPerPixel = bytesPerPixel;
+                this->format = (bytesPerPixel == 1) ? ALPR_PIXEL_GRAY : ALPR_PIXEL_BGR;
+                this->width = width;
+                this->height = height;
+                this->stride = width * bytesPerPixel;
+            };
+            // Raw pixel data in the given format, with 'stride' bytes per row of the first plane.
+            AlprImage(const unsigned char* pixelData, AlprPixelFormat format, int width, int height, int stride) {
+                this->data = pixelData;
+                this->bytesPerPixel = (format == ALPR_PIXEL_BGR) ? 3 : 1;
+                this->length = (long long) stride * height;
+                if (format == ALPR_PIXEL_NV12 || format == ALPR_PIXEL_I420) {
+                    this->length += this->length / 2;
+                }
+                this->format = format;
+                this->width = width;
+                this->height = height;
+                this->stride = stride;
+            };
+
+        const unsigned char* data;
+        long long length;
+        int bytesPerPixel; // 0 for encoded image data.  For NV12 and I420, the size of a Y sample (1).
+        AlprPixelFormat format;
+        int width;
+        int height;
+        int stride; // The number of bytes per row of pixels (of the Y plane, for NV12 and I420).
+
+        std::vector<AlprRegionOfInterest> regionsOfInterest; // When empty, the entire image is analyzed.
+    };
+
+    // Called from a background thread once an image passed to recognizeAsync() has been analyzed.
+    typedef void (*AlprResultsCallback)(const AlprResults& results, void* userData);
+
+    // The time spent in one stage of the analysis.  The percentiles are estimates, accurate to within 12.5%.
+    struct AlprStageStats {
+        std::string name;
+        int64_t count; // The number of times the stage ran.
+        double total_ms;
+        double max_ms;
+        double p50_ms;
+        double p95_ms;
+        double p99_ms;
+    };
+
+    struct AlprDisqualifyCount {
+        std::string reason;
+        int64_t count;
+    };
+
+    // Timing and counters collected across every Alpr instance in the process, since it started or was last reset.
+    struct AlprStats {
+        AlprStats() {
+            this->elapsed_ms = 0;
+            this->images = 0;
+            this->candidates_found = 0;
+            this->candidates_skipped = 0;
+            this->candidates_disqualified = 0;
+            this->candidates_ocrd = 0;
+            this->plates_read = 0;
+            this->full_scans = 0;
+            this->partial_scans = 0;
+        };
+
+        double elapsed_ms; // The time covered by these statistics.
+        int64_t images;
+        int64_t candidates_found; // Regions returned by the detector, including the smaller regions inside them.
+        int64_t candidates_skipped; // Candidates left out because the time budget ran out.
+        int64_t candidates_disqualified;
+        int64_t candidates_ocrd;
+        int64_t plates_read;
+        int64_t full_scans; // Video frames searched in full by a DetectionScheduler.
+        int64_t partial_scans; // Video frames where a DetectionScheduler only searched around the plates and motion.
+
+        std::vector<AlprStageStats> stages; // Every stage that ran at least once, in the order they happen.
+        std::vector<AlprDisqualifyCount> disqualify_reasons; // The most common first.
     };
 
 
@@ -126,7 +248,9 @@ namespace alpr {
       Alpr(const std::string country, const std::string configFile = "", const std::string runtimeDir = "");
       virtual ~Alpr();
 
-      // Set the country used for plate recognition
+      // Set the country used for plate recognition.  This also applies any changes made through getConfig().
+      // Unlike the setters below, it may be called while other threads are recognizing: it waits for the recognitions in
+      // progress to finish, and the ones started in the meantime wait for it.
       void setCountry(std::string country);
       
       // Update the prewarp setting without reloading the library
@@ -138,6 +262,13 @@ namespace alpr {
       void setTopN(int topN);
       void setDefaultRegion(std::string region);
 
+      // Limit the time spent on each image, in milliseconds.  Once the budget runs out, optional work is skipped and the
+      // results are marked as truncated.  0 removes the limit.  Defaults to "time_budget_ms" in the configuration.
+      void setTimeBudget(int milliseconds);
+
+      // The recognize() and detectPlates() functions may be called from several threads at once on the same instance.
+      // The setters above must not be called while a recognition is in progress.
+
       // Recognize from an image on disk
       AlprResults recognize(std::string filepath);
 
@@ -150,17 +281,46 @@ namespace alpr {
       // Recognize from raw pixel data.  
       AlprResults recognize(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest);
 
+      // Recognize from raw pixel data in the given format, with 'stride' bytes per row (of the Y plane, for NV12 and I420).
+      // The pixels are read in place.  For YUV formats, the Y plane is used directly, and only the plates are converted to color.
+      AlprResults recognize(const unsigned char* pixelData, AlprPixelFormat format, int imgWidth, int imgHeight, int stride, std::vector<AlprRegionOfInterest> regionsOfInterest);
+
+      // Recognize several images at once.  The images are analyzed in parallel, and the results are returned in the same order as the images.
+      std::vector<AlprResults> recognizeBatch(const std::vector<AlprImage>& images);
+
+      // Recognize an image in the background, and pass the results to the callback along with userData.
+      // The image data must remain valid until the callback is called.  Images are analyzed by the number of workers set by
+      // "async_workers" in the configuration.  If "async_queue_size" images are already waiting, this waits for room in the queue.
+      void recognizeAsync(const AlprImage& image, AlprResultsCallback callback, void* userData);
+
+      // Find plates in raw pixel data without reading them.  Returns the bounding box of each plate found.
+      std::vector<AlprRegionOfInterest> detectPlates(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest);
+
 
       static std::string toJson(const AlprResults results);
       static std::string toJson(const AlprPlateResult result);
+      // Appends the results as JSON to the end of the buffer.  Reusing the same buffer avoids allocating a new string for every image.
+      static void toJson(const AlprResults& results, std::string& buffer);
       static AlprResults fromJson(std::string json);
 
+      // Returns the timing and counters collected so far.  They are shared by every instance in the process.
+      // When 'reset' is true, collection starts over from this point.
+      static AlprStats getStats(bool reset = false);
+      static std::string statsToJson(const AlprStats& stats);
+
       bool isLoaded();
 
       static std::string getVersion();
 
+      // Each loaded country works from its own copy of the configuration, so changes made through the returned pointer
+      // only take effect once applyConfig() or setCountry() is called.  The configuration itself must not be changed while
+      // another thread may be recognizing.
       Config* getConfig();
 
+      // Applies the changes made through getConfig() to every loaded country.  Like setCountry(), it may be called while
+      // other threads are recognizing.
+      void applyConfig();
+
     private:
       AlprImpl* impl;
   };
@@ -85,6 +85,20 @@ OPENALPRC_DLL_EXPORT char* openalpr_recognize_rawimage(OPENALPR* instance, unsig
   
 }
 
+OPENALPRC_DLL_EXPORT char* openalpr_recognize_rawframe(OPENALPR* instance, unsigned char* pixelData, AlprCPixelFormat format, int imgWidth, int imgHeight, int stride, AlprCRegionOfInterest roi)
+{
+  std::vector<alpr::AlprRegionOfInterest> rois;
+  if (roi.width > 0 && roi.height > 0)
+    rois.push_back(alpr::AlprRegionOfInterest(roi.x, roi.y, roi.width, roi.height));
+
+  alpr::AlprResults results = ((alpr::Alpr*) instance)->recognize(pixelData, (alpr::AlprPixelFormat) format, imgWidth, imgHeight, stride, rois);
+  std::string json_string = alpr::Alpr::toJson(results);
+
+  char* result_obj = strdup(json_string.c_str());
+
+  return result_obj;
+}
+
 OPENALPRC_DLL_EXPORT char* openalpr_recognize_encodedimage(OPENALPR* instance, unsigned char* bytes, long long length, AlprCRegionOfInterest roi)
 {
   std::vector<alpr::AlprRegionOfInterest> rois;
@@ -102,6 +116,65 @@ OPENALPRC_DLL_EXPORT char* openalpr_recognize_encodedimage(OPENALPR* instance, u
   return result_obj;
 }
 
+static alpr::AlprImage convert_image(AlprCImage* cimage)
+{
+  alpr::AlprImage image;
+  if (cimage->bytesPerPixel == 0)
+    image = alpr::AlprImage(cimage->data, cimage->length);
+  else
+    image = alpr::AlprImage(cimage->data, cimage->bytesPerPixel, cimage->width, cimage->height);
+
+  AlprCRegionOfInterest roi = cimage->roi;
+  if (roi.width > 0 && roi.height > 0)
+    image.regionsOfInterest.push_back(alpr::AlprRegionOfInterest(roi.x, roi.y, roi.width, roi.height));
+
+  return image;
+}
+
+OPENALPRC_DLL_EXPORT void openalpr_recognize_batch(OPENALPR* instance, AlprCImage* images, int count, char** responses)
+{
+  std::vector<alpr::AlprImage> batch;
+  for (int i = 0; i < count; i++)
+    batch.push_back(convert_image(&images[i]));
+
+  std::vector<alpr::AlprResults> results = ((alpr::Alpr*) instance)->recognizeBatch(batch);
+  for (int i = 0; i < count; i++)
+  {
+    std::string json_string = alpr::Alpr::toJson(results[i]);
+    responses[i] = strdup(json_string.c_str());
+  }
+}
+
+struct AsyncCallback
+{
+  openalpr_recognize_callback callback;
+  void* user_data;
+};
+
+static void async_results_callback(const alpr::AlprResults& results, void* userData)
+{
+  AsyncCallback* async_callback = (AsyncCallback*) userData;
+  std::string json_string = alpr::Alpr::toJson(results);
+  async_callback->callback(json_string.c_str(), async_callback->user_data);
+  delete async_callback;
+}
+
+OPENALPRC_DLL_EXPORT void openalpr_recognize_async(OPENALPR* instance, AlprCImage* image, openalpr_recognize_callback callback, void* user_data)
+{
+  AsyncCallback* async_callback = new AsyncCallback();
+  async_callback->callback = callback;
+  async_callback->user_data = user_data;
+
+  ((alpr::Alpr*) instance)->recognizeAsync(convert_image(image), async_results_callback, async_callback);
+}
+
+
+OPENALPRC_DLL_EXPORT char* openalpr_get_stats(int reset)
+{
+  std::string json_string = alpr::Alpr::statsToJson(alpr::Alpr::getStats(reset != 0));
+
+  return strdup(json_string.c_str());
+}
 
 OPENALPRC_DLL_EXPORT void openalpr_free_response_string(char* response)
 {
@@ -38,6 +38,26 @@ struct AlprCRegionOfInterest
   int height;
 };
 
+// The layout of the pixel data passed to openalpr_recognize_rawframe.
+enum AlprCPixelFormat
+{
+  ALPRC_PIXEL_BGR = 0,  // Interleaved pixels (BGR, 3 channels).
+  ALPRC_PIXEL_GRAY = 1, // A single 8-bit channel.
+  ALPRC_PIXEL_NV12 = 2, // A Y plane, followed by an interleaved UV plane at half resolution.
+  ALPRC_PIXEL_I420 = 3  // A Y plane, followed by U and V planes at half resolution.
+};
+
+// A single image passed to openalpr_recognize_batch.  The image data isn't copied.
+struct AlprCImage
+{
+  unsigned char* data;
+  long long length;   // The number of bytes of encoded image data.  Ignored for raw pixel data.
+  int bytesPerPixel;  // 0 for encoded image data (e.g., JPEG, PNG).  Otherwise raw pixel data (BGR, 3 channels).
+  int width;          // Ignored for encoded image data.
+  int height;         // Ignored for encoded image data.
+  struct AlprCRegionOfInterest roi; // A region with a width or height of 0 analyzes the entire image.
+};
+
 // Initializes the openALPR library and returns a pointer to the OpenALPR instance
 OPENALPR* openalpr_init(const char* country, const char* configFile, const char* runtimeDir);
 
@@ -62,9 +82,30 @@ void openalpr_set_default_region(OPENALPR* instance, const char* region);
 // Caller must call free() on the returned object
 char* openalpr_recognize_rawimage(OPENALPR* instance, unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, struct AlprCRegionOfInterest roi);
 
+// Recognizes a raw frame without copying or converting it first.  'stride' is the number of bytes per row (of the Y plane for NV12 and I420).
+// The chroma planes of NV12 and I420 frames must directly follow the Y plane.
+// Caller must call free() on the returned object
+char* openalpr_recognize_rawframe(OPENALPR* instance, unsigned char* pixelData, enum AlprCPixelFormat format, int imgWidth, int imgHeight, int stride, struct AlprCRegionOfInterest roi);
+
 // Recognizes the encoded (e.g., JPEG, PNG) image.  bytes are the raw bytes for the image data.
 char* openalpr_recognize_encodedimage(OPENALPR* instance, unsigned char* bytes, long long length, struct AlprCRegionOfInterest roi);
 
+// Recognizes several images at once, in parallel.  One JSON response is stored in 'responses' for each image, in the same order.
+// 'responses' must have room for 'count' entries.  Each response must be freed with openalpr_free_response_string
+void openalpr_recognize_batch(OPENALPR* instance, struct AlprCImage* images, int count, char** responses);
+
+// Called from a background thread once an image passed to openalpr_recognize_async has been analyzed.
+// The response is only valid until the callback returns.
+typedef void (*openalpr_recognize_callback)(const char* response, void* user_data);
+
+// Recognizes an image in the background, and passes the JSON response to the callback along with user_data.
+// The image data must remain valid until the callback is called.  Waits for room if too many images are already queued.
+void openalpr_recognize_async(OPENALPR* instance, struct AlprCImage* image, openalpr_recognize_callback callback, void* user_data);
+
+// Returns the timing and counters collected so far as JSON.  They are shared by every instance in the process.
+// When reset is non-zero, collection starts over.  The response must be freed with openalpr_free_response_string
+char* openalpr_get_stats(int reset);
+
 // Frees a char* response that was provided from a recognition request.
 // This is required for interoperating with managed languages (e.g., C#) that can't free the memory themselves
 void openalpr_free_response_string(char* response);
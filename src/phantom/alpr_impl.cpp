@@ -14,6 +14,8 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "alpr_impl.h"
 #include "result_aggregator.h"
 
@@ -24,6 +26,27 @@ using namespace std;
 using namespace cv;
 
 namespace alpr {
+
+    // Holds the recognizers for a recognition, until it goes out of scope.
+    class RecognitionScope {
+        public:
+            RecognitionScope(RecognizerGate& gate) : gate(gate) { gate.beginRecognition(); }
+            ~RecognitionScope() { gate.endRecognition(); }
+
+        private:
+            RecognizerGate& gate;
+    };
+
+    // Holds the recognizers for a change, until it goes out of scope.
+    class ChangeScope {
+        public:
+            ChangeScope(RecognizerGate& gate) : gate(gate) { gate.beginChange(); }
+            ~ChangeScope() { gate.endChange(); }
+
+        private:
+            RecognizerGate& gate;
+    };
+
     AlprImpl::AlprImpl(const std::string country, const std::string configFile, const std::string runtimeDir) {
         timespec startTime;
         getTimeMonotonic(&startTime);
@@ -31,6 +54,8 @@ namespace alpr {
         config = new Config(country, configFile, runtimeDir);
 
         prewarp = ALPR_NULL_PTR;
+        task_pool = ALPR_NULL_PTR;
+        async_queue = ALPR_NULL_PTR;
 
 
         if (config->loaded == false) { // Config file or runtime dir not found.  Don't process any further.
@@ -39,6 +64,13 @@ namespace alpr {
 
         prewarp = new PreWarp(config);
 
+        // The thread that calls recognize() also runs tasks while it waits, so the pool needs one thread less.
+        unsigned int recognition_threads = config->recognitionThreads;
+        if (recognition_threads == 0) {
+            recognition_threads = std::max(tthread::thread::hardware_concurrency(), 1u);
+        }
+        task_pool = new TaskPool(recognition_threads - 1);
+
         loadRecognizers();
 
         setNumThreads(0);
@@ -46,23 +78,28 @@ namespace alpr {
         setDetectRegion(DEFAULT_DETECT_REGION);
         this->topN = DEFAULT_TOPN;
         setDefaultRegion("");
+        setTimeBudget(config->timeBudgetMs);
 
         timespec endTime;
         getTimeMonotonic(&endTime);
         if (config->debugTiming) {
-            cout << "Phantom Initialization Time: " << diffclock(startTime, endTime) << "ms." << endl;
+            cerr << "Phantom Initialization Time: " << diffclock(startTime, endTime) << "ms." << endl;
         }
 
     }
 
     AlprImpl::~AlprImpl() {
+        delete async_queue; // Finishes any images that are still waiting.
+        delete task_pool;
         delete config;
 
         typedef std::map<std::string, AlprRecognizers>::iterator it_type;
         for(it_type iterator = recognizers.begin(); iterator != recognizers.end(); iterator++) {
             delete iterator->second.plateDetector;
             delete iterator->second.stateDetector;
-            delete iterator->second.ocr;
+            delete iterator->second.stateDetectorMutex;
+            delete iterator->second.ocrPool;
+            delete iterator->second.config;
         }
 
         delete prewarp;
@@ -74,23 +111,36 @@ namespace alpr {
 
 
     AlprFullDetails AlprImpl::recognizeFullDetails(cv::Mat img, std::vector<cv::Rect> regionsOfInterest) {
+        // Convert image to grayscale if required
+        Mat grayImg = img;
+        if (img.data && img.channels() > 2) {
+            cvtColor( img, grayImg, COLOR_BGR2GRAY);
+        }
+
+        return recognizeFullDetails(ColorImage(img), grayImg, regionsOfInterest);
+    }
+
+    AlprFullDetails AlprImpl::recognizeFullDetails(ColorImage colorImg, cv::Mat grayImg, std::vector<cv::Rect> regionsOfInterest) {
         timespec startTime;
         getTimeMonotonic(&startTime);
 
+        RecognitionScope scope(recognizer_gate);
+
         AlprFullDetails response;
 
         int64_t start_time = getEpochTimeMs();
+        RecognitionDeadline deadline(timeBudgetMs);
 
         // Fix regions of interest in case they extend beyond the bounds of the image
         for (unsigned int i = 0; i < regionsOfInterest.size(); i++) {
-            regionsOfInterest[i] = expandRect(regionsOfInterest[i], 0, 0, img.cols, img.rows);
+            regionsOfInterest[i] = expandRect(regionsOfInterest[i], 0, 0, grayImg.cols, grayImg.rows);
         }
 
         for (unsigned int i = 0; i < regionsOfInterest.size(); i++) {
             response.results.regionsOfInterest.push_back(AlprRegionOfInterest(regionsOfInterest[i].x, regionsOfInterest[i].y, regionsOfInterest[i].width, regionsOfInterest[i].height));
         }
 
-        if (!img.data) {
+        if (!grayImg.data) {
             // Invalid image
             if (this->config->debugGeneral) {
                 std::cerr << "{\"error\": \"Invalid image\"}" << std::endl;
@@ -98,61 +148,118 @@ namespace alpr {
             return response;
         }
 
-        // Convert image to grayscale if required
-        Mat grayImg = img;
-        if (img.channels() > 2) {
-            cvtColor( img, grayImg, COLOR_BGR2GRAY);
-        }
-
         // Prewarp the image and ROIs if configured]
         std::vector<cv::Rect> warpedRegionsOfInterest = regionsOfInterest;
 
-        // Warp the image if prewarp is provided
-        grayImg = prewarp->warpImage(grayImg);
-        warpedRegionsOfInterest = prewarp->projectRects(regionsOfInterest, grayImg.cols, grayImg.rows, false);
-
-        // Iterate through each country provided (typically just one) and aggregate the results if necessary
-        ResultAggregator country_aggregator(MERGE_PICK_BEST, topN, config);
+        // Warp the image if prewarp is provided.  The transform is this image's own, since other threads may be
+        // recognizing images of a different size.
+        cv::Mat prewarpTransform = prewarp->getTransform(grayImg.size());
+        grayImg = prewarp->warpImage(grayImg, prewarpTransform);
+        warpedRegionsOfInterest = prewarp->projectRects(regionsOfInterest, prewarpTransform, grayImg.cols, grayImg.rows, false);
+
+        // Each country provided (typically just one) is analyzed once for each multiple analysis value set in its config,
+        // with a minor imperceptible tweak to the input image each time.  The passes don't depend on each other
+        // until their results are aggregated, so they are analyzed in parallel.
+        vector<ResultAggregator*> iter_aggregators;
+        vector<AnalysisPassTask> passes;
         for (unsigned int i = 0; i < config->loaded_countries.size(); i++) {
             if (config->debugGeneral) {
                 cout << "Analyzing: " << config->loaded_countries[i] << endl;
             }
 
-            config->setCountry(config->loaded_countries[i]);
-      
-            // Reapply analysis for each multiple analysis value set in the config,
-            // make a minor imperceptible tweak to the input image each time
-            ResultAggregator iter_aggregator(MERGE_COMBINE, topN, config);
-            for (unsigned int iteration = 0; iteration < config->analysis_count; iteration++) {
-                Mat iteration_image = iter_aggregator.applyImperceptibleChange(grayImg, iteration);
-                //drawAndWait(iteration_image);
-                AlprFullDetails iter_results = analyzeSingleCountry(img, iteration_image, warpedRegionsOfInterest);
-                iter_aggregator.addResults(iter_results);
+            AlprRecognizers& country_recognizers = recognizers.find(config->loaded_countries[i])->second;
+            iter_aggregators.push_back(new ResultAggregator(MERGE_COMBINE, topN, country_recognizers.config));
+
+            for (unsigned int iteration = 0; iteration < country_recognizers.config->analysis_count; iteration++) {
+                AnalysisPassTask pass;
+                pass.alpr = this;
+                pass.recognizers = &country_recognizers;
+                pass.aggregator = iter_aggregators[i];
+                pass.colorImg = colorImg;
+                pass.grayImg = grayImg;
+                pass.regionsOfInterest = warpedRegionsOfInterest;
+                pass.prewarpTransform = prewarpTransform;
+                pass.iteration = iteration;
+                pass.deadline = &deadline;
+                pass.skipped = false;
+                pass.failed = false;
+                passes.push_back(pass);
+            }
+        }
+
+        // With a time budget, the first pass of each country runs on its own, and the extra passes are only started if
+        // there's time left once it's done.  Otherwise they would all start before the budget could run out, and compete
+        // with the first pass for the cores.
+        bool staged = deadline.limited();
+        TaskGroup group;
+        for (unsigned int i = 0; i < passes.size(); i++) {
+            if (!staged || passes[i].iteration == 0) {
+                task_pool->run(&group, analysisPassTask, &passes[i]);
+            }
+        }
+        task_pool->wait(&group);
+
+        if (staged) {
+            for (unsigned int i = 0; i < passes.size(); i++) {
+                if (passes[i].iteration == 0) {
+                    continue;
+                } else if (deadline.expired()) {
+                    deadline.skip("analysis passes");
+                    passes[i].skipped = true;
+                } else {
+                    task_pool->run(&group, analysisPassTask, &passes[i]);
+                }
+            }
+            task_pool->wait(&group);
+        }
+
+        // Aggregate the results in the same order they would have been analyzed in one after another.
+        ResultAggregator country_aggregator(MERGE_PICK_BEST, topN, config);
+        unsigned int pass_index = 0;
+        for (unsigned int i = 0; i < config->loaded_countries.size(); i++) {
+            ResultAggregator& iter_aggregator = *iter_aggregators[i];
+            while (pass_index < passes.size() && passes[pass_index].aggregator == &iter_aggregator) {
+                if (passes[pass_index].failed) {
+                    for (unsigned int a = 0; a < iter_aggregators.size(); a++) {
+                        delete iter_aggregators[a];
+                    }
+                    std::rethrow_exception(passes[pass_index].error);
+                }
+                if (!passes[pass_index].skipped) {
+                    iter_aggregator.addResults(passes[pass_index].results);
+                }
+                pass_index++;
             }
       
             AlprFullDetails sub_results = iter_aggregator.getAggregateResults();
             sub_results.results.epoch_time = start_time;
-            sub_results.results.img_width = img.cols;
-            sub_results.results.img_height = img.rows;
+            sub_results.results.img_width = grayImg.cols;
+            sub_results.results.img_height = grayImg.rows;
             sub_results.results.regionsOfInterest = response.results.regionsOfInterest;
       
             country_aggregator.addResults(sub_results);
         }
         response = country_aggregator.getAggregateResults();
+        if (deadline.truncated()) {
+            response.results.truncated = true;
+            response.results.truncated_reason = deadline.reason();
+        }
 
-        timespec endTime;
-        getTimeMonotonic(&endTime);
-        if (config->debugTiming) {
-            cout << "Total Time to process image: " << diffclock(startTime, endTime) << "ms." << endl;
+        for (unsigned int i = 0; i < iter_aggregators.size(); i++) {
+            delete iter_aggregators[i];
         }
 
+        incrementCounter(COUNTER_IMAGES);
+        recordStageTime(config, STAGE_IMAGE, startTime);
+
         if (config->debugGeneral && config->debugShowImages) {
+            Mat img = colorImg.toMat();
             for (unsigned int i = 0; i < regionsOfInterest.size(); i++) {
                 rectangle(img, regionsOfInterest[i], Scalar(0,255,0), 2);
             }
 
-            for (unsigned int i = 0; i < response.plateRegions.size(); i++) {
-                rectangle(img, response.plateRegions[i].rect, Scalar(0, 0, 255), 2);
+            for (unsigned int i = 0; i < response.plateRegions.top_level.size(); i++) {
+                rectangle(img, response.plateRegions.topLevelRect(i), Scalar(0, 0, 255), 2);
             }
 
             for (unsigned int i = 0; i < response.results.plates.size(); i++) {
@@ -189,175 +296,309 @@ namespace alpr {
         return response;
     }
 
-    AlprFullDetails AlprImpl::analyzeSingleCountry(cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> warpedRegionsOfInterest) {
+    std::vector<AlprRegionOfInterest> AlprImpl::detectPlates(cv::Mat img, std::vector<cv::Rect> regionsOfInterest) {
+        std::vector<AlprRegionOfInterest> plates;
+
+        RecognitionScope scope(recognizer_gate);
+
+        if (!img.data) {
+            return plates;
+        }
+
+        for (unsigned int i = 0; i < regionsOfInterest.size(); i++) {
+            regionsOfInterest[i] = expandRect(regionsOfInterest[i], 0, 0, img.cols, img.rows);
+        }
+
+        Mat grayImg = img;
+        if (img.channels() > 2) {
+            cvtColor( img, grayImg, COLOR_BGR2GRAY);
+        }
+
+        cv::Mat prewarpTransform = prewarp->getTransform(grayImg.size());
+        grayImg = prewarp->warpImage(grayImg, prewarpTransform);
+        std::vector<cv::Rect> warpedRegionsOfInterest = prewarp->projectRects(regionsOfInterest, prewarpTransform, grayImg.cols, grayImg.rows, false);
+
+        for (unsigned int i = 0; i < config->loaded_countries.size(); i++) {
+            AlprRecognizers& country_recognizers = recognizers.find(config->loaded_countries[i])->second;
+
+            PlateRegions warpedPlateRegions;
+            if (country_recognizers.config->skipDetection == false) {
+                warpedPlateRegions = country_recognizers.plateDetector->detect(grayImg, warpedRegionsOfInterest);
+            } else {
+                for (unsigned int r = 0; r < warpedRegionsOfInterest.size(); r++) {
+                    warpedPlateRegions.add(warpedRegionsOfInterest[r]);
+                }
+            }
+
+            prewarp->projectPlateRegions(warpedPlateRegions, prewarpTransform, grayImg.cols, grayImg.rows, true);
+            for (unsigned int r = 0; r < warpedPlateRegions.top_level.size(); r++) {
+                cv::Rect rect = warpedPlateRegions.topLevelRect(r);
+                plates.push_back(AlprRegionOfInterest(rect.x, rect.y, rect.width, rect.height));
+            }
+        }
+
+        return plates;
+    }
+
+    AlprFullDetails AlprImpl::analyzeSingleCountry(AlprRecognizers& country_recognizers, ColorImage colorImg, cv::Mat grayImg, std::vector<cv::Rect> warpedRegionsOfInterest, cv::Mat prewarpTransform, RecognitionDeadline* deadline) {
         AlprFullDetails response;
 
-        AlprRecognizers country_recognizers = recognizers[config->country];
         timespec startTime;
         getTimeMonotonic(&startTime);
 
-        vector<PlateRegion> warpedPlateRegions;
+        PlateRegions warpedPlateRegions;
         // Find all the candidate regions
-        if (config->skipDetection == false) {
+        if (country_recognizers.config->skipDetection == false) {
             warpedPlateRegions = country_recognizers.plateDetector->detect(grayImg, warpedRegionsOfInterest);
         } else {
             // The user has elected to skip plate detection.  Instead, return a list of plate regions
             // based on their regions of interest
             for (unsigned int i = 0; i < warpedRegionsOfInterest.size(); i++) {
-                PlateRegion pr;
-                pr.rect = cv::Rect(warpedRegionsOfInterest[i]);
-                warpedPlateRegions.push_back(pr);
+                warpedPlateRegions.add(cv::Rect(warpedRegionsOfInterest[i]));
             }
         }
 
-        queue<PlateRegion> plateQueue;
-        for (unsigned int i = 0; i < warpedPlateRegions.size(); i++) {
-            plateQueue.push(warpedPlateRegions[i]);
-        }
-
+        // Candidates are analyzed in parallel, one level of the region hierarchy at a time.  The children of a region are only
+        // analyzed if no plate was read from it.  Results are collected in the same order as if each candidate were analyzed in turn.
+        // Once the time budget runs out, candidates that haven't started yet are skipped, except for the first one the detector found.
+        // Each level is a list of indices into the regions, which are only read.
         int platecount = 0;
-        while(!plateQueue.empty()) {
-            PlateRegion plateRegion = plateQueue.front();
-            plateQueue.pop();
-
-            PipelineData pipeline_data(colorImg, grayImg, plateRegion.rect, config);
-            pipeline_data.prewarp = prewarp;
+        const PlateRegions& regionTree = warpedPlateRegions;
+        vector<int> plateRegions = regionTree.top_level;
+        bool firstLevel = true;
+        while (plateRegions.size() > 0) {
+            incrementCounter(COUNTER_CANDIDATES_FOUND, plateRegions.size());
+
+            vector<PlateCandidateTask> tasks(plateRegions.size());
+            TaskGroup group;
+            for (unsigned int i = 0; i < plateRegions.size(); i++) {
+                tasks[i].alpr = this;
+                tasks[i].recognizers = &country_recognizers;
+                tasks[i].colorImg = colorImg;
+                tasks[i].grayImg = grayImg;
+                tasks[i].plateRegion = regionTree.regions[plateRegions[i]];
+                tasks[i].prewarpTransform = prewarpTransform;
+                tasks[i].deadline = deadline;
+                tasks[i].optional = !(firstLevel && i == 0);
+                tasks[i].plateQualified = false;
+                tasks[i].plateDetected = false;
+                tasks[i].skipped = false;
+                tasks[i].failed = false;
+                task_pool->run(&group, plateCandidateTask, &tasks[i]);
+            }
+            task_pool->wait(&group);
 
-            timespec platestarttime;
-            getTimeMonotonic(&platestarttime);
+            vector<int> childRegions;
+            for (unsigned int i = 0; i < tasks.size(); i++) {
+                if (tasks[i].failed) {
+                    std::rethrow_exception(tasks[i].error);
+                }
 
-            LicensePlateCandidate lp(&pipeline_data);
+                if (tasks[i].skipped) {
+                    continue;
+                }
 
-            lp.recognize();
+                // Candidates that were read but gave no characters still use up an index.
+                if (tasks[i].plateQualified) {
+                    tasks[i].plateResult.plate_index = platecount++;
+                }
 
-            bool plateDetected = false;
-            if (pipeline_data.disqualified && config->debugGeneral) {
-                cout << "Disqualify reason: " << pipeline_data.disqualify_reason << endl;
-            }
-            if (!pipeline_data.disqualified) {
-                AlprPlateResult plateResult;
-        
-                plateResult.country = config->country;
-        
-                // If there's only one pattern for a country, use it.  Otherwise use the default
-                if (country_recognizers.ocr->postProcessor.getPatterns().size() == 1) {
-                    plateResult.region = country_recognizers.ocr->postProcessor.getPatterns()[0];
+                if (tasks[i].plateDetected) {
+                    response.results.plates.push_back(tasks[i].plateResult);
                 } else {
-                    plateResult.region = defaultRegion;
+                    // Not a valid plate
+                    // Check if this plate has any children, if so, send them back up for processing
+                    for (int childidx = tasks[i].plateRegion.first_child; childidx >= 0; childidx = regionTree.regions[childidx].next_sibling) {
+                        childRegions.push_back(childidx);
+                    }
                 }
-        
-                plateResult.regionConfidence = 0;
-                plateResult.plate_index = platecount++;
-                plateResult.requested_topn = topN;
+            }
+            plateRegions = childRegions;
+            firstLevel = false;
 
-                // If using prewarp, remap the plate corners to the original image
-                vector<Point2f> cornerPoints = pipeline_data.plate_corners;
-                cornerPoints = prewarp->projectPoints(cornerPoints, true);
+            if (plateRegions.size() > 0 && deadline->expired()) {
+                deadline->skip("smaller regions inside candidates");
+                break;
+            }
+        }
 
-                for (int pointidx = 0; pointidx < 4; pointidx++) {
-                    plateResult.plate_points[pointidx].x = (int) cornerPoints[pointidx].x;
-                    plateResult.plate_points[pointidx].y = (int) cornerPoints[pointidx].y;
-                }
+        // Unwarp plate regions if necessary
+        prewarp->projectPlateRegions(warpedPlateRegions, prewarpTransform, grayImg.cols, grayImg.rows, true);
+        response.plateRegions = warpedPlateRegions;
 
-        
-                #ifndef SKIP_STATE_DETECTION
-                if (detectRegion && country_recognizers.stateDetector->isLoaded()) {
-                    std::vector<StateCandidate> state_candidates = country_recognizers.stateDetector->detect(pipeline_data.color_deskewed.data, pipeline_data.color_deskewed.elemSize(), pipeline_data.color_deskewed.cols, pipeline_data.color_deskewed.rows);
-                    if (state_candidates.size() > 0) {
-                        plateResult.region = state_candidates[0].state_code;
-                        plateResult.regionConfidence = (int) state_candidates[0].confidence;
-                    }
-                }
-                #endif
+        timespec endTime;
+        getTimeMonotonic(&endTime);
+        response.results.total_processing_time_ms = diffclock(startTime, endTime);
 
-                if (plateResult.region.length() > 0 && country_recognizers.ocr->postProcessor.regionIsValid(plateResult.region) == false) {
-                    std::cerr << "{\"error\": \"Invalid pattern provided: " << plateResult.region << ". Valid patterns are located in the " << config->country << ".patterns file" << "\"}" << std::endl;
-                }
+        return response;
+    }
 
-                country_recognizers.ocr->performOCR(&pipeline_data);
-                country_recognizers.ocr->postProcessor.analyze(plateResult.region, topN);
+    void AlprImpl::analysisPassTask(void* arg) {
+        AnalysisPassTask* pass = (AnalysisPassTask*) arg;
+        // The first pass for each country always runs.  The extra passes only refine its results.
+        if (pass->iteration > 0 && pass->deadline->expired()) {
+            pass->deadline->skip("analysis passes");
+            pass->skipped = true;
+            return;
+        }
 
-                timespec resultsStartTime;
-                getTimeMonotonic(&resultsStartTime);
+        try {
+            Mat iteration_image = pass->aggregator->applyImperceptibleChange(pass->grayImg, pass->iteration);
+            //drawAndWait(iteration_image);
+            pass->results = pass->alpr->analyzeSingleCountry(*pass->recognizers, pass->colorImg, iteration_image, pass->regionsOfInterest, pass->prewarpTransform, pass->deadline);
+        } catch (...) {
+            pass->error = std::current_exception();
+            pass->failed = true;
+        }
+    }
 
-                const vector<PPResult> ppResults = country_recognizers.ocr->postProcessor.getResults();
+    void AlprImpl::plateCandidateTask(void* arg) {
+        PlateCandidateTask* task = (PlateCandidateTask*) arg;
+        if (task->optional && task->deadline->expired()) {
+            task->deadline->skip("plate candidates");
+            task->skipped = true;
+            incrementCounter(COUNTER_CANDIDATES_SKIPPED);
+            return;
+        }
 
-                int bestPlateIndex = 0;
+        try {
+            task->plateDetected = task->alpr->analyzePlateCandidate(*task->recognizers, task->colorImg, task->grayImg, task->plateRegion, task->prewarpTransform, task->plateResult, task->plateQualified);
+        } catch (...) {
+            task->error = std::current_exception();
+            task->failed = true;
+        }
+    }
 
-                cv::Mat charTransformMatrix = getCharacterTransformMatrix(&pipeline_data);
-                bool isBestPlateSelected = false;
-                for (unsigned int pp = 0; pp < ppResults.size(); pp++) {
+    bool AlprImpl::analyzePlateCandidate(AlprRecognizers& country_recognizers, ColorImage colorImg, cv::Mat grayImg, PlateRegion plateRegion, cv::Mat prewarpTransform, AlprPlateResult& plateResult, bool& qualified) {
+        // Everything below reads the country's own copy of the configuration, since the main configuration is shared by every country.
+        Config* config = country_recognizers.config;
 
-                    // Set our "best plate" match to either the first entry, or the first entry with a postprocessor template match
-                    if (isBestPlateSelected == false && ppResults[pp].matchesTemplate) {
-                        bestPlateIndex = plateResult.topNPlates.size();
-                        isBestPlateSelected = true;
-                    }
+        PipelineData pipeline_data(colorImg, grayImg, plateRegion.rect, config);
+        pipeline_data.prewarp = prewarp;
+        pipeline_data.prewarp_transform = prewarpTransform;
 
-                    AlprPlate aplate;
-                    aplate.characters = ppResults[pp].letters;
-                    aplate.overall_confidence = ppResults[pp].totalscore;
-                    aplate.matches_template = ppResults[pp].matchesTemplate;
-
-                    // Grab detailed results for each character
-                    for (unsigned int c_idx = 0; c_idx < ppResults[pp].letter_details.size(); c_idx++) {
-                        AlprChar character_details;
-                        Letter l = ppResults[pp].letter_details[c_idx];
-            
-                        character_details.character = l.letter;
-                        character_details.confidence = l.totalscore;
-                        cv::Rect char_rect = pipeline_data.charRegionsFlat[l.charposition];
-                        std::vector<AlprCoordinate> charpoints = getCharacterPoints(char_rect, charTransformMatrix );
-                        for (int cpt = 0; cpt < 4; cpt++) {
-                            character_details.corners[cpt] = charpoints[cpt];
-                        }
-                        aplate.character_details.push_back(character_details);
-                    }
-                    plateResult.topNPlates.push_back(aplate);
-                }
+        timespec platestarttime;
+        getTimeMonotonic(&platestarttime);
 
-                if (plateResult.topNPlates.size() > bestPlateIndex) {
-                    AlprPlate bestPlate;
-                    bestPlate.characters = plateResult.topNPlates[bestPlateIndex].characters;
-                    bestPlate.matches_template = plateResult.topNPlates[bestPlateIndex].matches_template;
-                    bestPlate.overall_confidence = plateResult.topNPlates[bestPlateIndex].overall_confidence;
-                    bestPlate.character_details = plateResult.topNPlates[bestPlateIndex].character_details;
+        LicensePlateCandidate lp(&pipeline_data);
 
-                    plateResult.bestPlate = bestPlate;
-                }
+        lp.recognize();
 
-                timespec plateEndTime;
-                getTimeMonotonic(&plateEndTime);
-                plateResult.processing_time_ms = diffclock(platestarttime, plateEndTime);
-                if (config->debugTiming) {
-                    cout << "Result Generation Time: " << diffclock(resultsStartTime, plateEndTime) << "ms." << endl;
-                }
+        qualified = !pipeline_data.disqualified;
 
-                if (plateResult.topNPlates.size() > 0) {
-                    plateDetected = true;
-                    response.results.plates.push_back(plateResult);
-                }
+        if (pipeline_data.disqualified && config->debugGeneral) {
+            cout << "Disqualify reason: " << pipeline_data.disqualify_reason << endl;
+        }
+        if (pipeline_data.disqualified) {
+            countDisqualified(pipeline_data.disqualify_reason);
+            recordStageTime(config, STAGE_PLATE, platestarttime);
+            return false;
+        }
+
+        // This candidate's own OCR engine.  It's returned to the pool once the candidate has been read.
+        OcrLease ocr_lease(country_recognizers.ocrPool);
+        OCR* ocr = ocr_lease.ocr;
+
+        plateResult.country = config->country;
+
+        // If there's only one pattern for a country, use it.  Otherwise use the default
+        if (ocr->postProcessor.getPatterns().size() == 1) {
+            plateResult.region = ocr->postProcessor.getPatterns()[0];
+        } else {
+            plateResult.region = defaultRegion;
+        }
+
+        plateResult.regionConfidence = 0;
+        plateResult.requested_topn = topN;
+
+        // If using prewarp, remap the plate corners to the original image
+        vector<Point2f> cornerPoints = pipeline_data.plate_corners;
+        cornerPoints = prewarp->projectPoints(cornerPoints, prewarpTransform, true);
+
+        for (int pointidx = 0; pointidx < 4; pointidx++) {
+            plateResult.plate_points[pointidx].x = (int) cornerPoints[pointidx].x;
+            plateResult.plate_points[pointidx].y = (int) cornerPoints[pointidx].y;
+        }
+
+        #ifndef SKIP_STATE_DETECTION
+        if (detectRegion && country_recognizers.stateDetector->isLoaded()) {
+            tthread::lock_guard<tthread::mutex> guard(*country_recognizers.stateDetectorMutex);
+            std::vector<StateCandidate> state_candidates = country_recognizers.stateDetector->detect(pipeline_data.color_deskewed.data, pipeline_data.color_deskewed.elemSize(), pipeline_data.color_deskewed.cols, pipeline_data.color_deskewed.rows);
+            if (state_candidates.size() > 0) {
+                plateResult.region = state_candidates[0].state_code;
+                plateResult.regionConfidence = (int) state_candidates[0].confidence;
             }
+        }
+        #endif
+
+        if (plateResult.region.length() > 0 && ocr->postProcessor.regionIsValid(plateResult.region) == false) {
+            std::cerr << "{\"error\": \"Invalid pattern provided: " << plateResult.region << ". Valid patterns are located in the " << config->country << ".patterns file" << "\"}" << std::endl;
+        }
+
+        incrementCounter(COUNTER_CANDIDATES_OCRD);
+        ocr->performOCR(&pipeline_data);
+        ocr->postProcessor.analyze(plateResult.region, topN);
+
+        timespec resultsStartTime;
+        getTimeMonotonic(&resultsStartTime);
+
+        const vector<PPResult> ppResults = ocr->postProcessor.getResults();
 
-            if (!plateDetected) {
-                // Not a valid plate
-                // Check if this plate has any children, if so, send them back up for processing
-                for (unsigned int childidx = 0; childidx < plateRegion.children.size(); childidx++) {
-                plateQueue.push(plateRegion.children[childidx]);
+        int bestPlateIndex = 0;
+
+        cv::Mat charTransformMatrix = getCharacterTransformMatrix(&pipeline_data);
+        bool isBestPlateSelected = false;
+        for (unsigned int pp = 0; pp < ppResults.size(); pp++) {
+
+            // Set our "best plate" match to either the first entry, or the first entry with a postprocessor template match
+            if (isBestPlateSelected == false && ppResults[pp].matchesTemplate) {
+                bestPlateIndex = plateResult.topNPlates.size();
+                isBestPlateSelected = true;
             }
+
+            AlprPlate aplate;
+            aplate.characters = ppResults[pp].letters;
+            aplate.overall_confidence = ppResults[pp].totalscore;
+            aplate.matches_template = ppResults[pp].matchesTemplate;
+
+            // Grab detailed results for each character
+            for (unsigned int c_idx = 0; c_idx < ppResults[pp].letter_details.size(); c_idx++) {
+                AlprChar character_details;
+                Letter l = ppResults[pp].letter_details[c_idx];
+
+                character_details.character = l.letter;
+                character_details.confidence = l.totalscore;
+                cv::Rect char_rect = pipeline_data.charRegionsFlat[l.charposition];
+                std::vector<AlprCoordinate> charpoints = getCharacterPoints(char_rect, charTransformMatrix, prewarpTransform);
+                for (int cpt = 0; cpt < 4; cpt++) {
+                    character_details.corners[cpt] = charpoints[cpt];
+                }
+                aplate.character_details.push_back(character_details);
+            }
+            plateResult.topNPlates.push_back(aplate);
         }
 
-    }
+        if (plateResult.topNPlates.size() > bestPlateIndex) {
+            AlprPlate bestPlate;
+            bestPlate.characters = plateResult.topNPlates[bestPlateIndex].characters;
+            bestPlate.matches_template = plateResult.topNPlates[bestPlateIndex].matches_template;
+            bestPlate.overall_confidence = plateResult.topNPlates[bestPlateIndex].overall_confidence;
+            bestPlate.character_details = plateResult.topNPlates[bestPlateIndex].character_details;
 
-    // Unwarp plate regions if necessary
-    prewarp->projectPlateRegions(warpedPlateRegions, grayImg.cols, grayImg.rows, true);
-    response.plateRegions = warpedPlateRegions;
+            plateResult.bestPlate = bestPlate;
+        }
 
-    timespec endTime;
-    getTimeMonotonic(&endTime);
-    response.results.total_processing_time_ms = diffclock(startTime, endTime);
+        timespec plateEndTime;
+        getTimeMonotonic(&plateEndTime);
+        plateResult.processing_time_ms = diffclock(platestarttime, plateEndTime);
+        recordStageTime(config, STAGE_RESULT_GENERATION, resultsStartTime);
+        recordStageTime(config, STAGE_PLATE, platestarttime);
 
-    return response;
+        if (plateResult.topNPlates.size() == 0) {
+            return false;
+        }
+        incrementCounter(COUNTER_PLATES_READ);
+        return true;
     }
 
     AlprResults AlprImpl::recognize( std::vector<char> imageBytes) {
@@ -403,6 +644,24 @@ namespace alpr {
         }
     }
 
+    std::vector<AlprRegionOfInterest> AlprImpl::detectPlates(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest) {
+        try {
+            int arraySize = imgWidth * imgHeight * bytesPerPixel;
+            cv::Mat imgData = cv::Mat(arraySize, 1, CV_8U, pixelData);
+            cv::Mat img = imgData.reshape(bytesPerPixel, imgHeight);
+
+            if (regionsOfInterest.size() == 0) {
+                AlprRegionOfInterest fullFrame(0,0, img.cols, img.rows);
+                regionsOfInterest.push_back(fullFrame);
+            }
+
+            return this->detectPlates(img, this->convertRects(regionsOfInterest));
+        } catch (cv::Exception& e) {
+            std::cerr << "{\"error\": \"Caught exception in Phantom detectPlates: " << e.msg << "\"}" << std::endl;
+            return std::vector<AlprRegionOfInterest>();
+        }
+    }
+
     AlprResults AlprImpl::recognize(cv::Mat img) {
         std::vector<cv::Rect> regionsOfInterest;
         regionsOfInterest.push_back(cv::Rect(0, 0, img.cols, img.rows));
@@ -415,6 +674,95 @@ namespace alpr {
     }
 
 
+    std::vector<AlprResults> AlprImpl::recognizeBatch(const std::vector<AlprImage>& images) {
+        std::vector<AlprResults> results(images.size());
+
+        // Each image is decoded and analyzed as its own task, so one image can be decoded while others are being read.
+        std::vector<BatchImageTask> tasks(images.size());
+        TaskGroup group;
+        for (unsigned int i = 0; i < images.size(); i++) {
+            tasks[i].alpr = this;
+            tasks[i].image = &images[i];
+            tasks[i].results = &results[i];
+            task_pool->run(&group, batchImageTask, &tasks[i]);
+        }
+        task_pool->wait(&group);
+
+        return results;
+    }
+
+    void AlprImpl::batchImageTask(void* arg) {
+        BatchImageTask* task = (BatchImageTask*) arg;
+        *task->results = task->alpr->recognizeImage(*task->image);
+    }
+
+    void AlprImpl::recognizeAsync(const AlprImage& image, AlprResultsCallback callback, void* userData) {
+        {
+            tthread::lock_guard<tthread::mutex> guard(async_mutex);
+            if (async_queue == ALPR_NULL_PTR) {
+                async_queue = new WorkQueue(config->asyncWorkers, config->asyncQueueSize);
+            }
+        }
+
+        AsyncRecognitionJob* job = new AsyncRecognitionJob();
+        job->alpr = this;
+        job->image = image;
+        job->callback = callback;
+        job->userData = userData;
+        async_queue->submit(asyncRecognitionJob, job);
+    }
+
+    void AlprImpl::asyncRecognitionJob(void* arg) {
+        AsyncRecognitionJob* job = (AsyncRecognitionJob*) arg;
+        AlprResults results = job->alpr->recognizeImage(job->image);
+        job->callback(results, job->userData);
+        delete job;
+    }
+
+    AlprResults AlprImpl::recognizeImage(const AlprImage& image) {
+        // Images that can't be read are returned as empty results.
+        AlprResults results;
+        results.epoch_time = getEpochTimeMs();
+        results.img_width = 0;
+        results.img_height = 0;
+        results.total_processing_time_ms = 0;
+
+        try {
+            // The image data is wrapped rather than copied.
+            size_t stride = (image.stride > 0) ? image.stride : cv::Mat::AUTO_STEP;
+            std::vector<cv::Rect> regionsOfInterest = convertRects(image.regionsOfInterest);
+            if (regionsOfInterest.size() == 0) {
+                regionsOfInterest.push_back(cv::Rect(0, 0, image.width, image.height));
+            }
+
+            if (image.bytesPerPixel > 0 && (image.format == ALPR_PIXEL_NV12 || image.format == ALPR_PIXEL_I420)) {
+                // The Y plane is the grayscale image as it is.  Only the areas around plates are ever converted to color.
+                cv::Mat grayImg(image.height, image.width, CV_8UC1, (void*) image.data, stride);
+                ColorImage colorImg(image.data, image.format, image.width, image.height, (int) grayImg.step);
+                results = recognizeFullDetails(colorImg, grayImg, regionsOfInterest).results;
+            } else {
+                cv::Mat img;
+                if (image.bytesPerPixel == 0) {
+                    img = cv::imdecode(cv::Mat(1, (int) image.length, CV_8U, (void*) image.data), 1);
+                    if (image.regionsOfInterest.size() == 0) {
+                        regionsOfInterest[0] = cv::Rect(0, 0, img.cols, img.rows);
+                    }
+                } else {
+                    img = cv::Mat(image.height, image.width, CV_8UC(image.bytesPerPixel), (void*) image.data, stride);
+                }
+                results = recognizeFullDetails(img, regionsOfInterest).results;
+            }
+        } catch (cv::Exception& e) {
+            std::cerr << "{\"error\": \"Caught exception in Phantom recognize: " << e.msg << "\"}" << std::endl;
+        } catch (std::exception& e) {
+            // This runs on the task pool and the async workers, where nothing may be thrown.
+            std::cerr << "{\"error\": \"Caught exception in Phantom recognize: " << e.what() << "\"}" << std::endl;
+        } catch (...) {
+            std::cerr << "{\"error\": \"Caught unknown exception in Phantom recognize\"}" << std::endl;
+        }
+        return results;
+    }
+
     std::vector<cv::Rect> AlprImpl::convertRects(std::vector<AlprRegionOfInterest> regionsOfInterest) {
         std::vector<cv::Rect> rectRegions;
         for (unsigned int i = 0; i < regionsOfInterest.size(); i++) {
@@ -424,159 +772,184 @@ namespace alpr {
     }
 
     string AlprImpl::toJson( const AlprResults results ) {
-        cJSON *root, *jsonResults;
-        root = cJSON_CreateObject();
+        string response;
+        toJson(results, response);
+        return response;
+    }
 
-        cJSON_AddNumberToObject(root,"version",	2);
-        cJSON_AddStringToObject(root,"data_type", "alpr_results");
-        cJSON_AddStringToObject(root,"identifier", results.identifier.c_str());
-        cJSON_AddNumberToObject(root,"epoch_time", results.epoch_time);
-        cJSON_AddNumberToObject(root,"img_width", results.img_width);
-        cJSON_AddNumberToObject(root,"img_height", results.img_height);
-        cJSON_AddNumberToObject(root,"processing_time_ms", results.total_processing_time_ms );
+    void AlprImpl::toJson(const AlprResults& results, std::string& buffer) {
+        JsonWriter writer(buffer);
+        writer.beginObject();
 
-        // Add the regions of interest to the JSON
-        cJSON *rois;
-        cJSON_AddItemToObject(root, "regions_of_interest", 		rois=cJSON_CreateArray());
-        for (unsigned int i=0;i<results.regionsOfInterest.size();i++) {
-            cJSON *roi_object;
-            roi_object = cJSON_CreateObject();
-            cJSON_AddNumberToObject(roi_object, "x",  results.regionsOfInterest[i].x);
-            cJSON_AddNumberToObject(roi_object, "y",  results.regionsOfInterest[i].y);
-            cJSON_AddNumberToObject(roi_object, "width",  results.regionsOfInterest[i].width);
-            cJSON_AddNumberToObject(roi_object, "height",  results.regionsOfInterest[i].height);
+        writer.field("version", 2);
+        writer.field("data_type", "alpr_results");
+        writer.field("identifier", results.identifier);
+        if (results.stream_id >= 0) {
+            writer.field("stream_id", results.stream_id);
+        }
+        if (results.frames_skipped >= 0) {
+            writer.field("frames_skipped", results.frames_skipped);
+        }
+        writer.field("epoch_time", results.epoch_time);
+        writer.field("img_width", results.img_width);
+        writer.field("img_height", results.img_height);
+        writer.field("processing_time_ms", results.total_processing_time_ms);
+        if (results.truncated) {
+            writer.key("truncated");
+            writer.boolean(true);
+            writer.field("truncated_reason", results.truncated_reason);
+        }
 
-            cJSON_AddItemToArray(rois, roi_object);
+        // Add the regions of interest to the JSON
+        writer.key("regions_of_interest");
+        writer.beginArray();
+        for (unsigned int i = 0; i < results.regionsOfInterest.size(); i++) {
+            writer.beginObject();
+            writer.field("x", results.regionsOfInterest[i].x);
+            writer.field("y", results.regionsOfInterest[i].y);
+            writer.field("width", results.regionsOfInterest[i].width);
+            writer.field("height", results.regionsOfInterest[i].height);
+            writer.endObject();
         }
+        writer.endArray();
 
-        cJSON_AddItemToObject(root, "results", 		jsonResults=cJSON_CreateArray());
+        writer.key("results");
+        writer.beginArray();
         for (unsigned int i = 0; i < results.plates.size(); i++) {
-            cJSON *resultObj = createJsonObj( &results.plates[i] );
-            cJSON_AddItemToArray(jsonResults, resultObj);
+            writeJson(writer, results.plates[i]);
         }
+        writer.endArray();
 
-        // Print the JSON object to a string and return
-        char *out;
-        out=cJSON_PrintUnformatted(root);
-        cJSON_Delete(root);
-        string response(out);
-        free(out);
-        return response;
+        writer.endObject();
     }
 
-
-
     std::string AlprImpl::toJson(const AlprPlateResult result) {
-        cJSON *resultObj = createJsonObj( &result );
-        char *out;
-        out=cJSON_PrintUnformatted(resultObj);
-
-        cJSON_Delete(resultObj);
-
-        string response(out);
-
-        free(out);
-
+        string response;
+        JsonWriter writer(response);
+        writeJson(writer, result);
         return response;
     }
-    cJSON* AlprImpl::createJsonObj(const AlprPlateResult* result) {
-        cJSON *root, *coords, *candidates;
 
-        root=cJSON_CreateObject();
+    void AlprImpl::writeJson(JsonWriter& writer, const AlprPlateResult& result) {
+        writer.beginObject();
 
-        cJSON_AddStringToObject(root,"plate",		result->bestPlate.characters.c_str());
-        cJSON_AddNumberToObject(root,"confidence",		result->bestPlate.overall_confidence);
-        cJSON_AddNumberToObject(root,"matches_template",	result->bestPlate.matches_template);
+        writer.field("plate", result.bestPlate.characters);
+        writer.field("confidence", result.bestPlate.overall_confidence);
+        writer.field("matches_template", result.bestPlate.matches_template);
 
-        cJSON_AddNumberToObject(root,"plate_index",               result->plate_index);
+        writer.field("plate_index", result.plate_index);
 
-        cJSON_AddStringToObject(root,"region",		result->region.c_str());
-        cJSON_AddNumberToObject(root,"region_confidence",	result->regionConfidence);
+        writer.field("region", result.region);
+        writer.field("region_confidence", result.regionConfidence);
 
-        cJSON_AddNumberToObject(root,"processing_time_ms",	result->processing_time_ms);
-        cJSON_AddNumberToObject(root,"requested_topn",	result->requested_topn);
-        cJSON_AddItemToObject(root, "coordinates", 		coords=cJSON_CreateArray());
+        writer.field("processing_time_ms", result.processing_time_ms);
+        writer.field("requested_topn", result.requested_topn);
 
+        writer.key("coordinates");
+        writer.beginArray();
         for (int i=0; i<4; i++) { // Iterate over each of the 4 corners of the bounding box.
-            cJSON *coords_object;
-            coords_object = cJSON_CreateObject();
-            cJSON_AddNumberToObject(coords_object, "x",  result->plate_points[i].x);
-            cJSON_AddNumberToObject(coords_object, "y",  result->plate_points[i].y);
-
-            cJSON_AddItemToArray(coords, coords_object);
+            writer.beginObject();
+            writer.field("x", result.plate_points[i].x);
+            writer.field("y", result.plate_points[i].y);
+            writer.endObject();
         }
+        writer.endArray();
+
+        writer.key("candidates");
+        writer.beginArray();
+        for (unsigned int i = 0; i < result.topNPlates.size(); i++) {
+            writer.beginObject();
+            writer.field("plate", result.topNPlates[i].characters);
+            writer.field("confidence", result.topNPlates[i].overall_confidence);
+            writer.field("matches_template", result.topNPlates[i].matches_template);
+            writer.endObject();
+        }
+        writer.endArray();
 
+        writer.endObject();
+    }
 
-        cJSON_AddItemToObject(root, "candidates", 		candidates=cJSON_CreateArray());
-        for (unsigned int i = 0; i < result->topNPlates.size(); i++)  {
-            cJSON *candidate_object;
-            candidate_object = cJSON_CreateObject();
-            cJSON_AddStringToObject(candidate_object, "plate",  result->topNPlates[i].characters.c_str());
-            cJSON_AddNumberToObject(candidate_object, "confidence",  result->topNPlates[i].overall_confidence);
-            cJSON_AddNumberToObject(candidate_object, "matches_template",  result->topNPlates[i].matches_template);
-
-            cJSON_AddItemToArray(candidates, candidate_object);
+    // Missing or mistyped values are read as the default, rather than crashing on results from a different version.
+    static double jsonNumber(cJSON* object, const char* name, double defaultValue) {
+        cJSON* item = (object != NULL) ? cJSON_GetObjectItem(object, name) : NULL;
+        if (item == NULL || item->type != cJSON_Number) {
+            return defaultValue;
         }
+        return item->valuedouble;
+    }
 
-        return root;
+    static std::string jsonString(cJSON* object, const char* name) {
+        cJSON* item = (object != NULL) ? cJSON_GetObjectItem(object, name) : NULL;
+        if (item == NULL || item->type != cJSON_String || item->valuestring == NULL) {
+            return "";
+        }
+        return std::string(item->valuestring);
     }
 
     AlprResults AlprImpl::fromJson(std::string json) {
         AlprResults allResults;
 
         cJSON* root = cJSON_Parse(json.c_str());
+        if (root == NULL) {
+            return allResults;
+        }
 
-        int version = cJSON_GetObjectItem(root, "version")->valueint;
-        allResults.epoch_time = (int64_t) cJSON_GetObjectItem(root, "epoch_time")->valuedouble;
-        allResults.img_width = cJSON_GetObjectItem(root, "img_width")->valueint;
-        allResults.img_height = cJSON_GetObjectItem(root, "img_height")->valueint;
-        allResults.total_processing_time_ms = cJSON_GetObjectItem(root, "processing_time_ms")->valueint;
-
+        allResults.epoch_time = (int64_t) jsonNumber(root, "epoch_time", 0);
+        allResults.img_width = (int) jsonNumber(root, "img_width", 0);
+        allResults.img_height = (int) jsonNumber(root, "img_height", 0);
+        allResults.total_processing_time_ms = jsonNumber(root, "processing_time_ms", 0);
+        allResults.identifier = jsonString(root, "identifier");
+        allResults.stream_id = (int) jsonNumber(root, "stream_id", -1);
+        allResults.frames_skipped = (int64_t) jsonNumber(root, "frames_skipped", -1);
+        cJSON* truncated = cJSON_GetObjectItem(root, "truncated");
+        allResults.truncated = (truncated != NULL && truncated->type == cJSON_True);
+        allResults.truncated_reason = jsonString(root, "truncated_reason");
 
         cJSON* rois = cJSON_GetObjectItem(root,"regions_of_interest");
-        int numRois = cJSON_GetArraySize(rois);
+        int numRois = (rois != NULL) ? cJSON_GetArraySize(rois) : 0;
         for (int c = 0; c < numRois; c++) {
             cJSON* roi = cJSON_GetArrayItem(rois, c);
-            int x = cJSON_GetObjectItem(roi, "x")->valueint;
-            int y = cJSON_GetObjectItem(roi, "y")->valueint;
-            int width = cJSON_GetObjectItem(roi, "width")->valueint;
-            int height = cJSON_GetObjectItem(roi, "height")->valueint;
+            int x = (int) jsonNumber(roi, "x", 0);
+            int y = (int) jsonNumber(roi, "y", 0);
+            int width = (int) jsonNumber(roi, "width", 0);
+            int height = (int) jsonNumber(roi, "height", 0);
 
             AlprRegionOfInterest alprRegion(x,y,width,height);
             allResults.regionsOfInterest.push_back(alprRegion);
         }
 
         cJSON* resultsArray = cJSON_GetObjectItem(root,"results");
-        int resultsSize = cJSON_GetArraySize(resultsArray);
+        int resultsSize = (resultsArray != NULL) ? cJSON_GetArraySize(resultsArray) : 0;
 
         for (int i = 0; i < resultsSize; i++) {
             cJSON* item = cJSON_GetArrayItem(resultsArray, i);
             AlprPlateResult plate;
 
-            plate.processing_time_ms = cJSON_GetObjectItem(item, "processing_time_ms")->valuedouble;
-            plate.plate_index = cJSON_GetObjectItem(item, "plate_index")->valueint;
-            plate.region = std::string(cJSON_GetObjectItem(item, "region")->valuestring);
-            plate.regionConfidence = cJSON_GetObjectItem(item, "region_confidence")->valueint;
-            plate.requested_topn = cJSON_GetObjectItem(item, "requested_topn")->valueint;
+            plate.processing_time_ms = jsonNumber(item, "processing_time_ms", 0);
+            plate.plate_index = (int) jsonNumber(item, "plate_index", i);
+            plate.region = jsonString(item, "region");
+            plate.regionConfidence = (int) jsonNumber(item, "region_confidence", 0);
+            plate.requested_topn = (int) jsonNumber(item, "requested_topn", 0);
 
             cJSON* coordinates = cJSON_GetObjectItem(item,"coordinates");
+            int numCoordinates = (coordinates != NULL) ? cJSON_GetArraySize(coordinates) : 0;
             for (int c = 0; c < 4; c++) {
-                cJSON* coordinate = cJSON_GetArrayItem(coordinates, c);
+                cJSON* coordinate = (c < numCoordinates) ? cJSON_GetArrayItem(coordinates, c) : NULL;
                 AlprCoordinate alprcoord;
-                alprcoord.x = cJSON_GetObjectItem(coordinate, "x")->valueint;
-                alprcoord.y = cJSON_GetObjectItem(coordinate, "y")->valueint;
+                alprcoord.x = (int) jsonNumber(coordinate, "x", 0);
+                alprcoord.y = (int) jsonNumber(coordinate, "y", 0);
 
                 plate.plate_points[c] = alprcoord;
             }
 
             cJSON* candidates = cJSON_GetObjectItem(item,"candidates");
-            int numCandidates = cJSON_GetArraySize(candidates);
+            int numCandidates = (candidates != NULL) ? cJSON_GetArraySize(candidates) : 0;
             for (int c = 0; c < numCandidates; c++) {
                 cJSON* candidate = cJSON_GetArrayItem(candidates, c);
                 AlprPlate plateCandidate;
-                plateCandidate.characters = std::string(cJSON_GetObjectItem(candidate, "plate")->valuestring);
-                plateCandidate.overall_confidence = cJSON_GetObjectItem(candidate, "confidence")->valuedouble;
-                plateCandidate.matches_template = (cJSON_GetObjectItem(candidate, "matches_template")->valueint) != 0;
+                plateCandidate.characters = jsonString(candidate, "plate");
+                plateCandidate.overall_confidence = jsonNumber(candidate, "confidence", 0);
+                plateCandidate.matches_template = jsonNumber(candidate, "matches_template", 0) != 0;
 
                 plate.topNPlates.push_back(plateCandidate);
 
@@ -594,10 +967,16 @@ namespace alpr {
     }
 
     void AlprImpl::setCountry(std::string country) {
+    ChangeScope scope(recognizer_gate);
     config->load_countries(country);
     loadRecognizers();
     }
 
+    void AlprImpl::applyConfig() {
+    ChangeScope scope(recognizer_gate);
+    loadRecognizers();
+    }
+
     void AlprImpl::setPrewarp(std::string prewarp_config)
     {
     if (prewarp_config.length() == 0)
@@ -641,6 +1020,88 @@ namespace alpr {
     {
     this->defaultRegion = region;
     }
+    void AlprImpl::setTimeBudget(int milliseconds)
+    {
+    this->timeBudgetMs = std::max(milliseconds, 0);
+    }
+
+    RecognitionDeadline::RecognitionDeadline(int budget_ms) {
+        getTimeMonotonic(&start);
+        this->budget_ms = budget_ms;
+    }
+
+    RecognizerGate::RecognizerGate() {
+        recognitions = 0;
+        changing = false;
+    }
+
+    void RecognizerGate::beginRecognition() {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        while (changing) {
+            released.wait(mutex);
+        }
+        recognitions++;
+    }
+
+    void RecognizerGate::endRecognition() {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        recognitions--;
+        if (recognitions == 0) {
+            released.notify_all();
+        }
+    }
+
+    void RecognizerGate::beginChange() {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        while (changing) {
+            released.wait(mutex);
+        }
+        changing = true; // New recognitions wait from here on.
+        while (recognitions > 0) {
+            released.wait(mutex);
+        }
+    }
+
+    void RecognizerGate::endChange() {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        changing = false;
+        released.notify_all();
+    }
+
+    bool RecognitionDeadline::limited() {
+        return budget_ms > 0;
+    }
+
+    bool RecognitionDeadline::expired() {
+        if (budget_ms <= 0) {
+            return false;
+        }
+        timespec now;
+        getTimeMonotonic(&now);
+        return diffclock(start, now) >= budget_ms;
+    }
+
+    void RecognitionDeadline::skip(const std::string& what) {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        if (std::find(skipped.begin(), skipped.end(), what) == skipped.end()) {
+            skipped.push_back(what);
+        }
+    }
+
+    bool RecognitionDeadline::truncated() {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        return skipped.size() > 0;
+    }
+
+    std::string RecognitionDeadline::reason() {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        std::stringstream ss;
+        ss << "Time budget of " << budget_ms << "ms ran out; skipped ";
+        for (unsigned int i = 0; i < skipped.size(); i++) {
+            ss << ((i > 0) ? ", " : "") << skipped[i];
+        }
+        return ss.str();
+    }
 
     std::string AlprImpl::getVersion()
     {
@@ -654,24 +1115,34 @@ namespace alpr {
     void AlprImpl::loadRecognizers() {
     for (unsigned int i = 0; i < config->loaded_countries.size(); i++)
     {
-      config->setCountry(config->loaded_countries[i]);
+      std::string country = config->loaded_countries[i];
 
-      if (recognizers.find(config->country) == recognizers.end())
+      std::map<std::string, AlprRecognizers>::iterator existing = recognizers.find(country);
+      if (existing != recognizers.end())
       {
-        // Country training data has not already been loaded.  Load it.
-        AlprRecognizers recognizer;
-        recognizer.plateDetector = createDetector(config, prewarp);
-        recognizer.ocr = createOcr(config);
+        // Already loaded.  Refresh the country's copy of the configuration in place, since the loaded models point to it.
+        *existing->second.config = *config;
+        existing->second.config->setCountry(country);
+        continue;
+      }
 
-        #ifndef SKIP_STATE_DETECTION
-        recognizer.stateDetector = new StateDetector(this->config->country, this->config->config_file_path, this->config->runtimeBaseDir);
-        #else
-        recognizer.stateDetector = NULL;
-        #endif
+      // Country training data has not already been loaded.  Load it.
+      AlprRecognizers recognizer;
+      recognizer.config = new Config(*config);
+      recognizer.config->setCountry(country);
 
-        recognizers[config->country] = recognizer;
-      }
+      recognizer.plateDetector = createDetector(recognizer.config, prewarp);
+      recognizer.plateDetector->setTaskPool(task_pool);
+      recognizer.ocrPool = new OcrPool(recognizer.config);
+
+      #ifndef SKIP_STATE_DETECTION
+      recognizer.stateDetector = new StateDetector(country, this->config->config_file_path, this->config->runtimeBaseDir);
+      #else
+      recognizer.stateDetector = NULL;
+      #endif
+      recognizer.stateDetectorMutex = new tthread::mutex();
 
+      recognizers[country] = recognizer;
     }
     }
 
@@ -689,7 +1160,7 @@ namespace alpr {
     return transmtx;
     }
 
-    std::vector<AlprCoordinate> AlprImpl::getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx ) {
+    std::vector<AlprCoordinate> AlprImpl::getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx, cv::Mat prewarpTransform ) {
 
 
     std::vector<Point2f> points;
@@ -701,7 +1172,7 @@ namespace alpr {
     cv::perspectiveTransform(points, points, transmtx);
 
     // If using prewarp, remap the points to the original image
-    points = prewarp->projectPoints(points, true);
+    points = prewarp->projectPoints(points, prewarpTransform, true);
         
 
     std::vector<AlprCoordinate> cornersvector;
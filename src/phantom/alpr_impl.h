@@ -18,6 +18,7 @@
 #ifndef OPENALPR_ALPRIMPL_H
 #define OPENALPR_ALPRIMPL_H
 
+#include <exception>
 #include <list>
 #include <sstream>
 #include <vector>
@@ -35,12 +36,16 @@
 #include "../statedetection/state_detector.h"
 #include "ocr/ocr.h"
 #include "ocr/ocrfactory.h"
+#include "ocr/ocrpool.h"
 
 #include "constants.h"
 
 #include "cjson.h"
+#include "json_writer.h"
 
 #include "pipeline_data.h"
+#include "colorimage.h"
+#include "stats.h"
 
 #include "prewarp.h"
 
@@ -48,6 +53,9 @@
    
 #include "support/platform.h"
 #include "support/utf8.h"
+#include "support/tinythread.h"
+#include "support/taskpool.h"
+#include "support/workqueue.h"
 
 #define DEFAULT_TOPN 25
 #define DEFAULT_DETECT_REGION false
@@ -59,15 +67,129 @@ namespace alpr
 
   struct AlprFullDetails
   {
-    std::vector<PlateRegion> plateRegions;
+    PlateRegions plateRegions;
     AlprResults results;
   };
 
+  // The models loaded for a single country.  These are shared by every thread that calls recognize()
+  // on the same instance, so anything that changes while a plate is being read lives elsewhere:
+  // OCR engines (and their post-processors) are checked out of the pool for the duration of a call.
   struct AlprRecognizers
   {
+    Config* config; // A copy of the main configuration, set to this country.  Not changed while recognizing.
     Detector* plateDetector;
     StateDetector* stateDetector;
-    OCR* ocr;
+    tthread::mutex* stateDetectorMutex;
+    OcrPool* ocrPool;
+  };
+
+  class AlprImpl;
+  class ResultAggregator;
+
+  // The time budget for a single image.  Shared by every task working on the image, which check it before starting
+  // optional work, and record what they skipped.
+  class RecognitionDeadline
+  {
+    public:
+      // A budget of 0 never runs out.
+      RecognitionDeadline(int budget_ms);
+
+      // True if there is a budget at all.
+      bool limited();
+      bool expired();
+
+      // Records that part of the analysis was skipped.  Each reason is only listed once.
+      void skip(const std::string& what);
+
+      bool truncated();
+      std::string reason();
+
+    private:
+      timespec start;
+      int budget_ms;
+
+      std::vector<std::string> skipped;
+      tthread::mutex mutex;
+  };
+
+  // A single analysis of the image for one country, analyzed on the task pool.
+  struct AnalysisPassTask
+  {
+    AlprImpl* alpr;
+    AlprRecognizers* recognizers;
+    ResultAggregator* aggregator; // Shared by the passes of the same country.
+    ColorImage colorImg;
+    cv::Mat grayImg;
+    std::vector<cv::Rect> regionsOfInterest;
+    cv::Mat prewarpTransform; // Empty without a prewarp.
+    int iteration;
+    RecognitionDeadline* deadline;
+
+    AlprFullDetails results;
+    bool skipped; // The time budget ran out before this pass was started.
+
+    // Tasks on the pool must not throw, so whatever was thrown is rethrown on the thread waiting for the task.
+    bool failed;
+    std::exception_ptr error;
+  };
+
+  // A single image of a batch, analyzed on the task pool.
+  struct BatchImageTask
+  {
+    AlprImpl* alpr;
+    const AlprImage* image;
+    AlprResults* results;
+  };
+
+  // An image passed to recognizeAsync(), waiting to be analyzed.
+  struct AsyncRecognitionJob
+  {
+    AlprImpl* alpr;
+    AlprImage image;
+    AlprResultsCallback callback;
+    void* userData;
+  };
+
+  // A single plate candidate, analyzed on the task pool.
+  struct PlateCandidateTask
+  {
+    AlprImpl* alpr;
+    AlprRecognizers* recognizers;
+    ColorImage colorImg;
+    cv::Mat grayImg;
+    PlateRegion plateRegion;
+    cv::Mat prewarpTransform;
+    RecognitionDeadline* deadline;
+    bool optional; // Skipped if the time budget has already run out when the task starts.
+
+    AlprPlateResult plateResult;
+    bool plateQualified; // Not disqualified.  Every qualified candidate is numbered, whether or not it was read.
+    bool plateDetected;
+    bool skipped;
+
+    bool failed;
+    std::exception_ptr error;
+  };
+
+  // Lets any number of recognitions use the recognizers at once, or a single change to them while no recognition is running.
+  // A change waits for the recognitions in progress, and recognitions started while it is waiting wait for it.
+  class RecognizerGate
+  {
+    public:
+      RecognizerGate();
+
+      void beginRecognition();
+      void endRecognition();
+
+      void beginChange();
+      void endChange();
+
+    private:
+      int recognitions;
+      bool changing;
+
+      tthread::mutex mutex;
+      tthread::condition_variable released;
   };
 
   class AlprImpl
@@ -78,6 +200,7 @@ namespace alpr
       virtual ~AlprImpl();
 
       AlprFullDetails recognizeFullDetails(cv::Mat img, std::vector<cv::Rect> regionsOfInterest);
+      AlprFullDetails recognizeFullDetails(ColorImage colorImg, cv::Mat grayImg, std::vector<cv::Rect> regionsOfInterest);
 
       AlprResults recognize( std::vector<char> imageBytes );
       AlprResults recognize( std::vector<char> imageBytes, std::vector<AlprRegionOfInterest> regionsOfInterest );
@@ -85,23 +208,40 @@ namespace alpr
       AlprResults recognize( cv::Mat img );
       AlprResults recognize( cv::Mat img, std::vector<cv::Rect> regionsOfInterest );
 
-      AlprFullDetails analyzeSingleCountry(cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> regionsOfInterest);
+      std::vector<AlprResults> recognizeBatch( const std::vector<AlprImage>& images );
+      void recognizeAsync( const AlprImage& image, AlprResultsCallback callback, void* userData );
+      AlprResults recognizeImage( const AlprImage& image );
 
+      // Runs only plate detection, and returns the top-level plate regions in image coordinates.
+      std::vector<AlprRegionOfInterest> detectPlates( cv::Mat img, std::vector<cv::Rect> regionsOfInterest );
+      std::vector<AlprRegionOfInterest> detectPlates( unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest );
+
+      AlprFullDetails analyzeSingleCountry(AlprRecognizers& country_recognizers, ColorImage colorImg, cv::Mat grayImg, std::vector<cv::Rect> regionsOfInterest, cv::Mat prewarpTransform, RecognitionDeadline* deadline);
+      // Reads a single plate candidate.  Returns false if the candidate was disqualified, or no characters were read.
+      // 'qualified' is set when the candidate wasn't disqualified.
+      bool analyzePlateCandidate(AlprRecognizers& country_recognizers, ColorImage colorImg, cv::Mat grayImg, PlateRegion plateRegion, cv::Mat prewarpTransform, AlprPlateResult& plateResult, bool& qualified);
+
+      // The recognition functions above may be called from several threads at once.  setCountry() and applyConfig()
+      // wait for the recognitions in progress.  The other setters (and changes made to the configuration) must not run
+      // while a recognition is in progress.
       void setCountry(std::string country);
+      void applyConfig();
       void setPrewarp(std::string prewarp_config);
       void setMask(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight);
       
       void setDetectRegion(bool detectRegion);
       void setTopN(int topn);
       void setDefaultRegion(std::string region);
+      void setTimeBudget(int milliseconds);
 
       static std::string toJson( const AlprResults results );
       static std::string toJson( const AlprPlateResult result );
+      static void toJson(const AlprResults& results, std::string& buffer);
       
       static AlprResults fromJson(std::string json);
       static std::string getVersion();
 
-      static cJSON* createJsonObj(const AlprPlateResult* result);
+      static void writeJson(JsonWriter& writer, const AlprPlateResult& result);
       
       Config* config;
 
@@ -110,17 +250,31 @@ namespace alpr
     private:
 
       std::map<std::string, AlprRecognizers> recognizers;
+      RecognizerGate recognizer_gate; // Keeps the recognizers and their configurations from being refreshed under a recognition.
 
       PreWarp* prewarp;
 
+      // Runs the independent parts of each recognition (such as plate candidates) in parallel.
+      // Its size is set by the "recognition_threads" configuration value.
+      TaskPool* task_pool;
+      // Analyzes the images passed to recognizeAsync().  Created the first time it's needed.
+      WorkQueue* async_queue;
+      tthread::mutex async_mutex;
+      static void asyncRecognitionJob(void* arg);
+
+      static void batchImageTask(void* arg);
+      static void analysisPassTask(void* arg);
+      static void plateCandidateTask(void* arg);
+
       int topN;
       bool detectRegion;
       std::string defaultRegion;
+      int timeBudgetMs;
 
       void loadRecognizers();
       
       cv::Mat getCharacterTransformMatrix(PipelineData* pipeline_data );
-      std::vector<AlprCoordinate> getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx);
+      std::vector<AlprCoordinate> getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx, cv::Mat prewarpTransform);
       std::vector<cv::Rect> convertRects(std::vector<AlprRegionOfInterest> regionsOfInterest);
 
   };
@@ -0,0 +1,566 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "binaryresults.h"
+
+#include <string.h>
+
+#include "json_writer.h"
+
+using namespace std;
+
+namespace alpr {
+
+    // Encoding
+
+    static void writeUint8(string& buffer, uint8_t value) {
+        buffer.push_back((char) value);
+    }
+
+    static void writeUint16(string& buffer, uint16_t value) {
+        buffer.push_back((char) (value & 0xff));
+        buffer.push_back((char) (value >> 8));
+    }
+
+    static void writeUint32(string& buffer, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            buffer.push_back((char) ((value >> (i * 8)) & 0xff));
+        }
+    }
+
+    static void writeInt64(string& buffer, int64_t value) {
+        uint64_t bits = (uint64_t) value;
+        for (int i = 0; i < 8; i++) {
+            buffer.push_back((char) ((bits >> (i * 8)) & 0xff));
+        }
+    }
+
+    static void writeInt32(string& buffer, int value) {
+        writeUint32(buffer, (uint32_t) value);
+    }
+
+    static void writeFloat(string& buffer, float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        writeUint32(buffer, bits);
+    }
+
+    static void writeString(string& buffer, const string& value) {
+        writeUint32(buffer, (uint32_t) value.size());
+        buffer.append(value);
+    }
+
+    static void writeCoordinate(string& buffer, const AlprCoordinate& value) {
+        writeInt32(buffer, value.x);
+        writeInt32(buffer, value.y);
+    }
+
+    // Records start with their byte count, which is only known once the rest of the record has been written.
+    static size_t beginRecord(string& buffer) {
+        writeUint32(buffer, 0);
+        return buffer.size();
+    }
+
+    static void endRecord(string& buffer, size_t start) {
+        uint32_t length = (uint32_t) (buffer.size() - start);
+        for (int i = 0; i < 4; i++) {
+            buffer[start - 4 + i] = (char) ((length >> (i * 8)) & 0xff);
+        }
+    }
+
+    static void writePlate(string& buffer, const AlprPlate& plate) {
+        size_t start = beginRecord(buffer);
+
+        writeString(buffer, plate.characters);
+        writeFloat(buffer, plate.overall_confidence);
+        writeUint8(buffer, plate.matches_template ? 1 : 0);
+
+        writeUint32(buffer, (uint32_t) plate.character_details.size());
+        for (unsigned int i = 0; i < plate.character_details.size(); i++) {
+            const AlprChar& character = plate.character_details[i];
+            for (int c = 0; c < 4; c++) {
+                writeCoordinate(buffer, character.corners[c]);
+            }
+            writeFloat(buffer, character.confidence);
+            writeString(buffer, character.character);
+        }
+
+        endRecord(buffer, start);
+    }
+
+    static void writePlateResult(string& buffer, const AlprPlateResult& plate) {
+        size_t start = beginRecord(buffer);
+
+        writeInt32(buffer, plate.requested_topn);
+        writeInt32(buffer, plate.plate_index);
+        writeInt32(buffer, plate.regionConfidence);
+        writeFloat(buffer, plate.processing_time_ms);
+        for (int c = 0; c < 4; c++) {
+            writeCoordinate(buffer, plate.plate_points[c]);
+        }
+        writeString(buffer, plate.country);
+        writeString(buffer, plate.region);
+
+        writePlate(buffer, plate.bestPlate);
+        writeUint32(buffer, (uint32_t) plate.topNPlates.size());
+        for (unsigned int i = 0; i < plate.topNPlates.size(); i++) {
+            writePlate(buffer, plate.topNPlates[i]);
+        }
+
+        endRecord(buffer, start);
+    }
+
+    void encodeBinaryResults(const AlprResults& results, string& buffer) {
+        writeUint32(buffer, ALPR_BINARY_MAGIC);
+        writeUint16(buffer, ALPR_BINARY_VERSION);
+        writeUint16(buffer, results.truncated ? ALPR_BINARY_TRUNCATED : 0);
+        size_t start = beginRecord(buffer);
+
+        writeInt64(buffer, results.epoch_time);
+        writeInt64(buffer, results.frame_number);
+        writeInt64(buffer, results.frames_skipped);
+        writeInt32(buffer, results.img_width);
+        writeInt32(buffer, results.img_height);
+        writeInt32(buffer, results.stream_id);
+        writeFloat(buffer, results.total_processing_time_ms);
+        writeString(buffer, results.identifier);
+        writeString(buffer, results.truncated_reason);
+
+        writeUint32(buffer, (uint32_t) results.regionsOfInterest.size());
+        for (unsigned int i = 0; i < results.regionsOfInterest.size(); i++) {
+            writeInt32(buffer, results.regionsOfInterest[i].x);
+            writeInt32(buffer, results.regionsOfInterest[i].y);
+            writeInt32(buffer, results.regionsOfInterest[i].width);
+            writeInt32(buffer, results.regionsOfInterest[i].height);
+        }
+
+        writeUint32(buffer, (uint32_t) results.plates.size());
+        for (unsigned int i = 0; i < results.plates.size(); i++) {
+            writePlateResult(buffer, results.plates[i]);
+        }
+
+        endRecord(buffer, start);
+    }
+
+    // Decoding
+
+    AlprBinaryCursor::AlprBinaryCursor() {
+        position = NULL;
+        end = NULL;
+    }
+
+    AlprBinaryCursor::AlprBinaryCursor(const unsigned char* data, size_t length) {
+        position = data;
+        end = data + length;
+    }
+
+    bool AlprBinaryCursor::take(size_t count, const unsigned char*& bytes) {
+        if (position == NULL || (size_t) (end - position) < count) {
+            position = NULL;
+            return false;
+        }
+        bytes = position;
+        position += count;
+        return true;
+    }
+
+    bool AlprBinaryCursor::readUint8(uint8_t& value) {
+        const unsigned char* bytes;
+        if (!take(1, bytes)) {
+            return false;
+        }
+        value = bytes[0];
+        return true;
+    }
+
+    bool AlprBinaryCursor::readUint16(uint16_t& value) {
+        const unsigned char* bytes;
+        if (!take(2, bytes)) {
+            return false;
+        }
+        value = (uint16_t) (bytes[0] | (bytes[1] << 8));
+        return true;
+    }
+
+    bool AlprBinaryCursor::readUint32(uint32_t& value) {
+        const unsigned char* bytes;
+        if (!take(4, bytes)) {
+            return false;
+        }
+        value = (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+        return true;
+    }
+
+    bool AlprBinaryCursor::readInt32(int& value) {
+        uint32_t bits;
+        if (!readUint32(bits)) {
+            return false;
+        }
+        value = (int) bits;
+        return true;
+    }
+
+    bool AlprBinaryCursor::readInt64(int64_t& value) {
+        const unsigned char* bytes;
+        if (!take(8, bytes)) {
+            return false;
+        }
+        uint64_t bits = 0;
+        for (int i = 7; i >= 0; i--) {
+            bits = (bits << 8) | bytes[i];
+        }
+        value = (int64_t) bits;
+        return true;
+    }
+
+    bool AlprBinaryCursor::readFloat(float& value) {
+        uint32_t bits;
+        if (!readUint32(bits)) {
+            return false;
+        }
+        memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+
+    bool AlprBinaryCursor::readString(AlprBinaryString& value) {
+        const unsigned char* bytes;
+        if (!readUint32(value.length) || !take(value.length, bytes)) {
+            return false;
+        }
+        value.data = (const char*) bytes;
+        return true;
+    }
+
+    bool AlprBinaryCursor::readCoordinate(AlprCoordinate& value) {
+        return readInt32(value.x) && readInt32(value.y);
+    }
+
+    bool AlprBinaryCursor::readBytes(size_t count, AlprBinaryCursor& part) {
+        const unsigned char* bytes;
+        if (!take(count, bytes)) {
+            return false;
+        }
+        part = AlprBinaryCursor(bytes, count);
+        return true;
+    }
+
+    bool AlprBinaryCursor::readRecord(AlprBinaryCursor& record) {
+        uint32_t length;
+        return readUint32(length) && readBytes(length, record);
+    }
+
+    bool AlprBinaryPlate::read(AlprBinaryCursor& cursor) {
+        characters_read = 0;
+        if (!cursor.readRecord(record)) {
+            return false;
+        }
+
+        uint8_t matches;
+        record.readString(characters);
+        record.readFloat(overall_confidence);
+        record.readUint8(matches);
+        record.readUint32(character_count);
+        matches_template = matches != 0;
+        return !record.failed();
+    }
+
+    bool AlprBinaryPlate::nextCharacter(AlprBinaryChar& character) {
+        if (characters_read >= character_count) {
+            return false;
+        }
+        characters_read++;
+
+        for (int c = 0; c < 4; c++) {
+            record.readCoordinate(character.corners[c]);
+        }
+        record.readFloat(character.confidence);
+        record.readString(character.character);
+        return !record.failed();
+    }
+
+    bool AlprBinaryPlateResult::read(AlprBinaryCursor& cursor) {
+        candidates_read = 0;
+        if (!cursor.readRecord(record)) {
+            return false;
+        }
+
+        record.readInt32(requested_topn);
+        record.readInt32(plate_index);
+        record.readInt32(regionConfidence);
+        record.readFloat(processing_time_ms);
+        for (int c = 0; c < 4; c++) {
+            record.readCoordinate(plate_points[c]);
+        }
+        record.readString(country);
+        record.readString(region);
+        if (!bestPlate.read(record)) {
+            return false;
+        }
+        record.readUint32(candidate_count);
+        return !record.failed();
+    }
+
+    bool AlprBinaryPlateResult::nextCandidate(AlprBinaryPlate& candidate) {
+        if (candidates_read >= candidate_count) {
+            return false;
+        }
+        candidates_read++;
+        return candidate.read(record);
+    }
+
+    bool AlprBinaryResults::open(const unsigned char* data, size_t length) {
+        regions_read = 0;
+        plates_read = 0;
+        region_count = 0;
+        plate_count = 0;
+        encoded_size = 0;
+
+        AlprBinaryCursor cursor(data, length);
+        uint32_t magic;
+        uint16_t flags;
+        if (!cursor.readUint32(magic) || magic != ALPR_BINARY_MAGIC) {
+            return false;
+        }
+        if (!cursor.readUint16(version) || version != ALPR_BINARY_VERSION || !cursor.readUint16(flags)) {
+            return false;
+        }
+        if (!cursor.readRecord(body)) {
+            return false;
+        }
+        encoded_size = ALPR_BINARY_HEADER_SIZE + body.remaining();
+        truncated = (flags & ALPR_BINARY_TRUNCATED) != 0;
+
+        body.readInt64(epoch_time);
+        body.readInt64(frame_number);
+        body.readInt64(frames_skipped);
+        body.readInt32(img_width);
+        body.readInt32(img_height);
+        body.readInt32(stream_id);
+        body.readFloat(total_processing_time_ms);
+        body.readString(identifier);
+        body.readString(truncated_reason);
+
+        // Each region of interest takes 16 bytes, so they're split off from the plates that follow them.
+        if (!body.readUint32(region_count) || region_count > body.remaining() / 16) {
+            return false;
+        }
+        body.readBytes(region_count * 16, regions);
+        body.readUint32(plate_count);
+        return !body.failed();
+    }
+
+    bool AlprBinaryResults::nextRegionOfInterest(AlprRegionOfInterest& regionOfInterest) {
+        if (regions_read >= region_count) {
+            return false;
+        }
+        regions_read++;
+
+        regions.readInt32(regionOfInterest.x);
+        regions.readInt32(regionOfInterest.y);
+        regions.readInt32(regionOfInterest.width);
+        regions.readInt32(regionOfInterest.height);
+        return !regions.failed();
+    }
+
+    bool AlprBinaryResults::nextPlate(AlprBinaryPlateResult& plate) {
+        if (plates_read >= plate_count) {
+            return false;
+        }
+        plates_read++;
+        return plate.read(body);
+    }
+
+    static void readPlate(AlprBinaryPlate& view, AlprPlate& plate) {
+        plate.characters = view.characters.str();
+        plate.overall_confidence = view.overall_confidence;
+        plate.matches_template = view.matches_template;
+
+        AlprBinaryChar character;
+        while (view.nextCharacter(character)) {
+            AlprChar details;
+            for (int c = 0; c < 4; c++) {
+                details.corners[c] = character.corners[c];
+            }
+            details.confidence = character.confidence;
+            details.character = character.character.str();
+            plate.character_details.push_back(details);
+        }
+    }
+
+    bool decodeBinaryResults(const unsigned char* data, size_t length, AlprResults& results) {
+        AlprBinaryResults view;
+        if (!view.open(data, length)) {
+            return false;
+        }
+
+        results.epoch_time = view.epoch_time;
+        results.frame_number = view.frame_number;
+        results.frames_skipped = view.frames_skipped;
+        results.img_width = view.img_width;
+        results.img_height = view.img_height;
+        results.stream_id = view.stream_id;
+        results.total_processing_time_ms = view.total_processing_time_ms;
+        results.identifier = view.identifier.str();
+        results.truncated = view.truncated;
+        results.truncated_reason = view.truncated_reason.str();
+
+        AlprRegionOfInterest regionOfInterest(0, 0, 0, 0);
+        for (uint32_t i = 0; i < view.region_count; i++) {
+            if (!view.nextRegionOfInterest(regionOfInterest)) {
+                return false;
+            }
+            results.regionsOfInterest.push_back(regionOfInterest);
+        }
+
+        AlprBinaryPlateResult plateView;
+        for (uint32_t i = 0; view.nextPlate(plateView); i++) {
+            AlprPlateResult plate;
+            plate.requested_topn = plateView.requested_topn;
+            plate.plate_index = plateView.plate_index;
+            plate.regionConfidence = plateView.regionConfidence;
+            plate.processing_time_ms = plateView.processing_time_ms;
+            for (int c = 0; c < 4; c++) {
+                plate.plate_points[c] = plateView.plate_points[c];
+            }
+            plate.country = plateView.country.str();
+            plate.region = plateView.region.str();
+            readPlate(plateView.bestPlate, plate.bestPlate);
+
+            AlprBinaryPlate candidate;
+            for (uint32_t c = 0; c < plateView.candidate_count; c++) {
+                if (!plateView.nextCandidate(candidate)) {
+                    return false;
+                }
+                plate.topNPlates.push_back(AlprPlate());
+                readPlate(candidate, plate.topNPlates.back());
+            }
+
+            results.plates.push_back(plate);
+        }
+
+        return results.plates.size() == view.plate_count;
+    }
+
+    // JSON
+
+    static bool writeJson(JsonWriter& writer, AlprBinaryResults& view) {
+        writer.beginObject();
+
+        writer.field("version", 2);
+        writer.field("data_type", "alpr_results");
+        writer.key("identifier");
+        writer.value(view.identifier.data, view.identifier.length);
+        if (view.stream_id >= 0) {
+            writer.field("stream_id", view.stream_id);
+        }
+        if (view.frames_skipped >= 0) {
+            writer.field("frames_skipped", view.frames_skipped);
+        }
+        writer.field("epoch_time", view.epoch_time);
+        writer.field("img_width", view.img_width);
+        writer.field("img_height", view.img_height);
+        writer.field("processing_time_ms", view.total_processing_time_ms);
+        if (view.truncated) {
+            writer.key("truncated");
+            writer.boolean(true);
+            writer.key("truncated_reason");
+            writer.value(view.truncated_reason.data, view.truncated_reason.length);
+        }
+
+        writer.key("regions_of_interest");
+        writer.beginArray();
+        AlprRegionOfInterest regionOfInterest(0, 0, 0, 0);
+        for (uint32_t i = 0; i < view.region_count; i++) {
+            if (!view.nextRegionOfInterest(regionOfInterest)) {
+                return false;
+            }
+            writer.beginObject();
+            writer.field("x", regionOfInterest.x);
+            writer.field("y", regionOfInterest.y);
+            writer.field("width", regionOfInterest.width);
+            writer.field("height", regionOfInterest.height);
+            writer.endObject();
+        }
+        writer.endArray();
+
+        writer.key("results");
+        writer.beginArray();
+        AlprBinaryPlateResult plate;
+        uint32_t plates = 0;
+        for (; view.nextPlate(plate); plates++) {
+            writer.beginObject();
+
+            writer.key("plate");
+            writer.value(plate.bestPlate.characters.data, plate.bestPlate.characters.length);
+            writer.field("confidence", plate.bestPlate.overall_confidence);
+            writer.field("matches_template", plate.bestPlate.matches_template);
+            writer.field("plate_index", plate.plate_index);
+            writer.key("region");
+            writer.value(plate.region.data, plate.region.length);
+            writer.field("region_confidence", plate.regionConfidence);
+            writer.field("processing_time_ms", plate.processing_time_ms);
+            writer.field("requested_topn", plate.requested_topn);
+
+            writer.key("coordinates");
+            writer.beginArray();
+            for (int c = 0; c < 4; c++) {
+                writer.beginObject();
+                writer.field("x", plate.plate_points[c].x);
+                writer.field("y", plate.plate_points[c].y);
+                writer.endObject();
+            }
+            writer.endArray();
+
+            writer.key("candidates");
+            writer.beginArray();
+            AlprBinaryPlate candidate;
+            for (uint32_t c = 0; c < plate.candidate_count; c++) {
+                if (!plate.nextCandidate(candidate)) {
+                    return false;
+                }
+                writer.beginObject();
+                writer.key("plate");
+                writer.value(candidate.characters.data, candidate.characters.length);
+                writer.field("confidence", candidate.overall_confidence);
+                writer.field("matches_template", candidate.matches_template);
+                writer.endObject();
+            }
+            writer.endArray();
+
+            writer.endObject();
+        }
+        writer.endArray();
+
+        writer.endObject();
+        return plates == view.plate_count;
+    }
+
+    bool binaryResultsToJson(const unsigned char* data, size_t length, string& buffer) {
+        AlprBinaryResults view;
+        if (!view.open(data, length)) {
+            return false;
+        }
+
+        size_t start = buffer.size();
+        JsonWriter writer(buffer);
+        if (!writeJson(writer, view)) {
+            buffer.resize(start); // Don't leave half of the results behind.
+            return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_BINARYRESULTS_H
+#define OPENALPR_BINARYRESULTS_H
+
+#include <stddef.h>
+#include <string>
+#include <stdint.h>
+
+#include "alpr.h"
+
+// A compact binary encoding of AlprResults, for programs that pass results between machines at a high rate.  Unlike
+// the JSON output, it includes the country, the frame number, and the corners and confidence of each character.
+//
+// Every value is little-endian.  Strings are a uint32 byte count followed by the bytes, without a terminator.
+//
+//   Header:     uint32 magic ("PHRB"), uint16 version, uint16 flags, uint32 byte count of the body
+//   Body:       int64 epoch_time, int64 frame_number, int64 frames_skipped, int32 img_width, int32 img_height,
+//               int32 stream_id, float32 total_processing_time_ms, string identifier, string truncated_reason,
+//               uint32 region count, then int32 x, y, width, height for each region of interest,
+//               uint32 plate count, then a plate record for each plate
+//   Plate:      uint32 byte count of the rest of the record, int32 requested_topn, int32 plate_index,
+//               int32 regionConfidence, float32 processing_time_ms, int32 x, y for each of the 4 plate_points,
+//               string country, string region, a candidate record for bestPlate,
+//               uint32 candidate count, then a candidate record for each of the topNPlates
+//   Candidate:  uint32 byte count of the rest of the record, string characters, float32 overall_confidence,
+//               uint8 matches_template, uint32 character count, then for each character: int32 x, y for each of
+//               the 4 corners, float32 confidence, string character
+//
+// The only flag so far is ALPR_BINARY_TRUNCATED.
+//
+// Newer encoders may add fields to the end of the body and of each record, which older decoders skip over.
+namespace alpr {
+
+    const uint32_t ALPR_BINARY_MAGIC = 0x42524850; // "PHRB"
+    const uint16_t ALPR_BINARY_VERSION = 1;
+    const size_t ALPR_BINARY_HEADER_SIZE = 12;
+
+    const uint16_t ALPR_BINARY_TRUNCATED = 0x0001; // AlprResults::truncated
+
+    // Points into the encoded data, so it's only valid as long as the data is.
+    struct AlprBinaryString {
+        const char* data;
+        uint32_t length;
+
+        std::string str() const { return std::string(data, length); }
+    };
+
+    // Reads values from a range of encoded data.  Once a read runs past the end of the range, it and every read after it fail.
+    class OPENALPR_DLL_EXPORT AlprBinaryCursor {
+        public:
+            AlprBinaryCursor();
+            AlprBinaryCursor(const unsigned char* data, size_t length);
+
+            bool readUint8(uint8_t& value);
+            bool readUint16(uint16_t& value);
+            bool readUint32(uint32_t& value);
+            bool readInt32(int& value);
+            bool readInt64(int64_t& value);
+            bool readFloat(float& value);
+            bool readString(AlprBinaryString& value);
+            bool readCoordinate(AlprCoordinate& value);
+
+            // Splits off the next 'count' bytes, and moves past them.
+            bool readBytes(size_t count, AlprBinaryCursor& part);
+            // Splits off a record that starts with its own byte count, and moves past it.
+            bool readRecord(AlprBinaryCursor& record);
+
+            bool failed() const { return position == NULL; }
+            size_t remaining() const { return (position == NULL) ? 0 : end - position; }
+
+        private:
+            bool take(size_t count, const unsigned char*& bytes);
+
+            const unsigned char* position;
+            const unsigned char* end;
+    };
+
+    // The views below decode the results in place, without allocating any memory.  Variable length lists are read in
+    // order with the next...() functions, which return false once the list is finished or the data is damaged.
+
+    struct AlprBinaryChar {
+        AlprCoordinate corners[4];
+        float confidence;
+        AlprBinaryString character;
+    };
+
+    class OPENALPR_DLL_EXPORT AlprBinaryPlate {
+        public:
+            bool read(AlprBinaryCursor& cursor);
+            bool nextCharacter(AlprBinaryChar& character);
+
+            AlprBinaryString characters;
+            float overall_confidence;
+            bool matches_template;
+            uint32_t character_count;
+
+        private:
+            AlprBinaryCursor record;
+            uint32_t characters_read;
+    };
+
+    class OPENALPR_DLL_EXPORT AlprBinaryPlateResult {
+        public:
+            bool read(AlprBinaryCursor& cursor);
+            bool nextCandidate(AlprBinaryPlate& candidate);
+
+            int requested_topn;
+            int plate_index;
+            int regionConfidence;
+            float processing_time_ms;
+            AlprCoordinate plate_points[4];
+            AlprBinaryString country;
+            AlprBinaryString region;
+            AlprBinaryPlate bestPlate;
+            uint32_t candidate_count;
+
+        private:
+            AlprBinaryCursor record;
+            uint32_t candidates_read;
+    };
+
+    class OPENALPR_DLL_EXPORT AlprBinaryResults {
+        public:
+            // Checks the header and reads the fixed fields.  Returns false if the data doesn't start with a complete set
+            // of results in a version this decoder understands.  The data may continue past the end of the results.
+            bool open(const unsigned char* data, size_t length);
+
+            bool nextRegionOfInterest(AlprRegionOfInterest& regionOfInterest);
+            bool nextPlate(AlprBinaryPlateResult& plate);
+
+            // The number of bytes taken up by the results, including the header.
+            size_t size() const { return encoded_size; }
+
+            uint16_t version;
+            int64_t epoch_time;
+            int64_t frame_number;
+            int64_t frames_skipped;
+            int img_width;
+            int img_height;
+            int stream_id;
+            float total_processing_time_ms;
+            AlprBinaryString identifier;
+            bool truncated;
+            AlprBinaryString truncated_reason;
+            uint32_t region_count;
+            uint32_t plate_count;
+
+        private:
+            AlprBinaryCursor regions;
+            AlprBinaryCursor body;
+            size_t encoded_size;
+            uint32_t regions_read;
+            uint32_t plates_read;
+    };
+
+    // Appends the encoded results to the end of the buffer.
+    OPENALPR_DLL_EXPORT void encodeBinaryResults(const AlprResults& results, std::string& buffer);
+
+    // Decodes the results into regular AlprResults.  Returns false if the data isn't valid.
+    OPENALPR_DLL_EXPORT bool decodeBinaryResults(const unsigned char* data, size_t length, AlprResults& results);
+
+    // Appends the same JSON that Alpr::toJson would write for the results to the end of the buffer.  The fields that
+    // are only in the binary encoding are left out.  Returns false if the data isn't valid.
+    OPENALPR_DLL_EXPORT bool binaryResultsToJson(const unsigned char* data, size_t length, std::string& buffer);
+
+}
+
+#endif // OPENALPR_BINARYRESULTS_H
@@ -18,6 +18,7 @@
 */
 
 #include "colorfilter.h"
+#include "stats.h"
 
 using namespace cv;
 using namespace std;
@@ -50,12 +51,7 @@ namespace alpr
 
     findCharColors();
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "  -- ColorFilter Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_COLOR_FILTER, startTime);
   }
 
   ColorFilter::~ColorFilter()
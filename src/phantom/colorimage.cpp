@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <algorithm>
+
+#include "colorimage.h"
+
+using namespace cv;
+
+namespace alpr
+{
+
+  ColorImage::ColorImage()
+  {
+    yuvData = NULL;
+    format = ALPR_PIXEL_BGR;
+    width = 0;
+    height = 0;
+    stride = 0;
+  }
+
+  ColorImage::ColorImage(cv::Mat image)
+  {
+    this->image = image;
+    yuvData = NULL;
+    format = (image.channels() == 1) ? ALPR_PIXEL_GRAY : ALPR_PIXEL_BGR;
+    width = image.cols;
+    height = image.rows;
+    stride = image.step;
+  }
+
+  ColorImage::ColorImage(const unsigned char* yuvData, AlprPixelFormat format, int width, int height, int stride)
+  {
+    this->yuvData = yuvData;
+    this->format = format;
+    this->width = width;
+    this->height = height;
+    this->stride = stride;
+  }
+
+  bool ColorImage::isYuv()
+  {
+    return (format == ALPR_PIXEL_NV12 || format == ALPR_PIXEL_I420);
+  }
+
+  int ColorImage::type()
+  {
+    if (isYuv())
+      return CV_8UC3;
+    return image.type();
+  }
+
+  cv::Mat ColorImage::getRegion(cv::Rect& region)
+  {
+    if (!isYuv())
+    {
+      region = region & Rect(0, 0, image.cols, image.rows);
+      return image(region);
+    }
+
+    // The chroma planes are stored at half resolution, so the region has to start and end on an even pixel.
+    int x1 = std::max(region.x, 0) & ~1;
+    int y1 = std::max(region.y, 0) & ~1;
+    int x2 = std::min((region.x + region.width + 1) & ~1, width & ~1);
+    int y2 = std::min((region.y + region.height + 1) & ~1, height & ~1);
+    if (x2 <= x1 || y2 <= y1)
+    {
+      region = Rect(0, 0, 0, 0);
+      return Mat();
+    }
+    region = Rect(x1, y1, x2 - x1, y2 - y1);
+
+    // Gather the region's samples from each plane into a small frame of the same format, and convert only that.
+    Mat yuv_region(region.height * 3 / 2, region.width, CV_8UC1);
+    unsigned char* dst = yuv_region.data;
+
+    for (int y = y1; y < y2; y++)
+    {
+      memcpy(dst, yuvData + (y * stride) + x1, region.width);
+      dst += region.width;
+    }
+
+    const unsigned char* chroma = yuvData + (height * stride);
+    Mat bgr;
+    if (format == ALPR_PIXEL_NV12)
+    {
+      for (int y = y1 / 2; y < y2 / 2; y++)
+      {
+        memcpy(dst, chroma + (y * stride) + x1, region.width);
+        dst += region.width;
+      }
+      cvtColor(yuv_region, bgr, COLOR_YUV2BGR_NV12);
+    }
+    else
+    {
+      int chroma_stride = stride / 2;
+      const unsigned char* planes[2] = { chroma, chroma + ((height / 2) * chroma_stride) };
+      for (int p = 0; p < 2; p++)
+      {
+        for (int y = y1 / 2; y < y2 / 2; y++)
+        {
+          memcpy(dst, planes[p] + (y * chroma_stride) + (x1 / 2), region.width / 2);
+          dst += region.width / 2;
+        }
+      }
+      cvtColor(yuv_region, bgr, COLOR_YUV2BGR_I420);
+    }
+
+    return bgr;
+  }
+
+  cv::Mat ColorImage::toMat()
+  {
+    if (!isYuv())
+      return image;
+
+    Mat yuv(height * 3 / 2, width, CV_8UC1, (void*) yuvData, stride);
+    Mat bgr;
+    cvtColor(yuv, bgr, (format == ALPR_PIXEL_NV12) ? COLOR_YUV2BGR_NV12 : COLOR_YUV2BGR_I420);
+    return bgr;
+  }
+
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_COLORIMAGE_H
+#define OPENALPR_COLORIMAGE_H
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include "alpr.h"
+
+namespace alpr
+{
+
+  // The color version of the image being analyzed.  Most of the pipeline only needs the grayscale image, so frames
+  // that arrive as YUV planes are left as they are, and only the regions that are needed in color are converted to BGR.
+  class ColorImage
+  {
+    public:
+      ColorImage();
+      // Interleaved (BGR) or grayscale pixels.
+      ColorImage(cv::Mat image);
+      // NV12 or I420 planes.  The chroma planes follow the Y plane, which is 'stride' bytes per row.
+      ColorImage(const unsigned char* yuvData, AlprPixelFormat format, int width, int height, int stride);
+
+      bool isYuv();
+
+      // The type of the images returned by getRegion() and toMat().
+      int type();
+
+      // Returns the given region in BGR (or grayscale).  The region is shrunk to fit inside the image, and for YUV frames,
+      // aligned to the chroma samples, so it may be slightly different afterwards.
+      cv::Mat getRegion(cv::Rect& region);
+
+      // Returns the entire image in BGR (or grayscale).  YUV frames are converted in full.
+      cv::Mat toMat();
+
+    private:
+      cv::Mat image;
+
+      const unsigned char* yuvData;
+      AlprPixelFormat format;
+      int width;
+      int height;
+      int stride;
+  };
+
+}
+
+#endif // OPENALPR_COLORIMAGE_H
@@ -185,6 +185,11 @@ namespace alpr
     maxDetectionInputWidth = getInt(ini, defaultIni, "", "max_detection_input_width", 1280);
     maxDetectionInputHeight = getInt(ini, defaultIni, "", "max_detection_input_height", 768);
 
+    detectionTiling = getBoolean(ini, defaultIni, "", "detection_tiling", false);
+    detectionTileWidth = std::max(getInt(ini, defaultIni, "", "detection_tile_width", 1280), 1);
+    detectionTileHeight = std::max(getInt(ini, defaultIni, "", "detection_tile_height", 720), 1);
+    detectionTileOverlap = std::max(getInt(ini, defaultIni, "", "detection_tile_overlap", 160), 0);
+
     contrastDetectionThreshold = getFloat(ini, defaultIni, "", "contrast_detection_threshold", 0.3);
     
     mustMatchPattern = getBoolean(ini, defaultIni, "", "must_match_pattern", false);
@@ -194,6 +199,13 @@ namespace alpr
     detection_mask_image = getString(ini, defaultIni, "", "detection_mask_image", "");
     
     analysis_count = getInt(ini, defaultIni, "", "analysis_count", 1);
+
+    recognitionThreads = std::max(getInt(ini, defaultIni, "", "recognition_threads", 0), 0);
+
+    timeBudgetMs = std::max(getInt(ini, defaultIni, "", "time_budget_ms", 0), 0);
+
+    asyncWorkers = std::max(getInt(ini, defaultIni, "", "async_workers", 2), 1);
+    asyncQueueSize = std::max(getInt(ini, defaultIni, "", "async_queue_size", 16), 1);
     
     prewarp = getString(ini, defaultIni, "", "prewarp", "");
             
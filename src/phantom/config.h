@@ -53,6 +53,11 @@ namespace alpr
       float maxPlateHeightPercent;
       int maxDetectionInputWidth;
       int maxDetectionInputHeight;
+
+      bool detectionTiling;
+      int detectionTileWidth;
+      int detectionTileHeight;
+      int detectionTileOverlap;
       
       float contrastDetectionThreshold;
       
@@ -61,6 +66,13 @@ namespace alpr
       std::string detection_mask_image;
 
       int analysis_count;
+
+      int recognitionThreads;
+
+      int timeBudgetMs;
+
+      int asyncWorkers;
+      int asyncQueueSize;
       
       bool auto_invert;
       bool always_invert;
@@ -17,6 +17,11 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <exception>
+
 #include "detector.h"
 
 using namespace cv;
@@ -25,9 +30,116 @@ using namespace std;
 namespace alpr
 {
 
+  // Boxes from different searches that overlap by more than this (intersection over union) are the same plate.
+  const float TILE_DUPLICATE_OVERLAP = 0.5f;
+
+  // A search of one part of the frame.
+  struct DetectionSearch
+  {
+    Detector* detector;
+    Mat roi_gray;
+    Point origin; // Where roi_gray is in the frame.
+    Rect region;
+    Rect owned; // Only the plates centered inside this rectangle are kept, so plates in the overlap between tiles are kept once.
+    float scale_factor;
+    Size min_plate_size;
+    Size max_plate_size;
+
+    vector<Rect> plates; // In frame coordinates.
+    bool failed;
+    std::exception_ptr error; // Rethrown on the thread that waits for the search.
+  };
+
+  static void runSearch(DetectionSearch* search)
+  {
+    Mat cropped = search->roi_gray(Rect(search->region.x - search->origin.x, search->region.y - search->origin.y,
+                                        search->region.width, search->region.height));
+
+    int w = cropped.size().width;
+    int h = cropped.size().height;
+    float scale_factor = search->scale_factor;
+
+    if (scale_factor != 1.0)
+      resize(cropped, cropped, Size(w * scale_factor, h * scale_factor));
+
+    vector<Rect> allRegions = search->detector->find_plates(cropped, search->min_plate_size, search->max_plate_size);
+
+    for (unsigned int i = 0; i < allRegions.size(); i++)
+    {
+      allRegions[i].x = (allRegions[i].x / scale_factor);
+      allRegions[i].y = (allRegions[i].y / scale_factor);
+      allRegions[i].width = allRegions[i].width / scale_factor;
+      allRegions[i].height = allRegions[i].height / scale_factor;
+
+      // Ensure that the rectangle isn't < 0 or > maxWidth/Height
+      allRegions[i] = expandRect(allRegions[i], 0, 0, w, h);
+
+      allRegions[i].x = allRegions[i].x + search->region.x;
+      allRegions[i].y = allRegions[i].y + search->region.y;
+
+      Point center(allRegions[i].x + (allRegions[i].width / 2), allRegions[i].y + (allRegions[i].height / 2));
+      if (search->owned.contains(center))
+        search->plates.push_back(allRegions[i]);
+    }
+  }
+
+  // The search of one region of interest.
+  struct RoiSearch
+  {
+    Detector* detector;
+    Mat frame_gray;
+    Rect roi;
+    PreparedMask mask;
+
+    PlateRegions regions;
+    bool failed;
+    std::exception_ptr error;
+  };
+
+  static void searchTask(void* arg)
+  {
+    DetectionSearch* search = (DetectionSearch*) arg;
+    try
+    {
+      runSearch(search);
+    }
+    catch (...)
+    {
+      search->error = std::current_exception();
+      search->failed = true;
+    }
+  }
+
+  // The offsets of tiles that cover 'length' pixels, spread evenly so that neighbouring tiles overlap by at least 'overlap'.
+  static vector<int> tileOffsets(int length, int tile, int overlap)
+  {
+    vector<int> offsets;
+    if (length <= tile)
+    {
+      offsets.push_back(0);
+      return offsets;
+    }
+
+    int step = tile - overlap;
+    int count = 1 + ((length - tile + step - 1) / step);
+    for (int i = 0; i < count; i++)
+      offsets.push_back((int) (((int64_t) i * (length - tile)) / (count - 1)));
+    return offsets;
+  }
+
+  static float intersectionOverUnion(const Rect& a, const Rect& b)
+  {
+    float intersection = (a & b).area();
+    float combined = a.area() + b.area() - intersection;
+    if (combined <= 0)
+      return 0;
+    return intersection / combined;
+  }
+
   Detector::Detector(Config* config, PreWarp* prewarp) : detector_mask(config, prewarp)
   {
     this->config = config;
+    this->task_pool = NULL;
 
     // Load the mask specified in the config if it exists
     if (config->detection_mask_image.length() > 0 && fileExists(config->detection_mask_image.c_str()))
@@ -50,21 +162,26 @@ namespace alpr
     detector_mask.setMask(mask);
   }
 
+  void Detector::setTaskPool(TaskPool* task_pool) {
+    this->task_pool = task_pool;
+  }
+
   bool Detector::isLoaded()
   {
     return this->loaded;
   }
 
-  vector<PlateRegion> Detector::detect(cv::Mat frame)
+  PlateRegions Detector::detect(cv::Mat frame)
   {
     std::vector<cv::Rect> regionsOfInterest;
     regionsOfInterest.push_back(Rect(0, 0, frame.cols, frame.rows));
     return this->detect(frame, regionsOfInterest);
   }
 
-  vector<PlateRegion> Detector::detect(Mat frame, std::vector<cv::Rect> regionsOfInterest)
+  PlateRegions Detector::detect(Mat frame, std::vector<cv::Rect> regionsOfInterest)
   {
 
+    // The gray frame is read, never written, so a gray input is used as it is.
     Mat frame_gray;
     
     if (frame.channels() > 2)
@@ -73,32 +190,31 @@ namespace alpr
     }
     else
     {
-      frame.copyTo(frame_gray);
+      frame_gray = frame;
     }
 
-    // Apply the detection mask if it has been specified by the user
-    if (detector_mask.mask_loaded)
-      frame_gray = detector_mask.apply_mask(frame_gray);
+    // Fit the detection mask to the frame if it has been specified by the user.  The pixels aren't masked: the
+    // masked areas are skipped instead, and any plates found partly inside them are dropped.
+    PreparedMask mask = detector_mask.prepare(frame_gray.size());
 
     // Setup debug mask image
     Mat mask_debug_img;
-    if (detector_mask.mask_loaded && config->debugDetector)
+    if (mask.loaded && config->debugDetector)
     {
-      frame_gray.copyTo(mask_debug_img);
-      cvtColor(frame_gray, mask_debug_img, COLOR_GRAY2BGR);
+      cvtColor(mask.apply_mask(frame_gray), mask_debug_img, COLOR_GRAY2BGR);
     }
     
-    vector<PlateRegion> detectedRegions;   
-    for (int i = 0; i < regionsOfInterest.size(); i++)
+    vector<RoiSearch> searches;
+    for (unsigned int i = 0; i < regionsOfInterest.size(); i++)
     {
       Rect roi = regionsOfInterest[i];
       
       // Adjust the ROI to be inside the detection mask (if it exists)
-      if (detector_mask.mask_loaded)
-        roi = detector_mask.getRoiInsideMask(roi);
+      if (mask.loaded)
+        roi = mask.getRoiInsideMask(roi);
 
       // Draw ROIs on debug mask image
-      if (detector_mask.mask_loaded && config->debugDetector)
+      if (mask.loaded && config->debugDetector)
         rectangle(mask_debug_img, roi, Scalar(0,255,255), 3);
       
       // Sanity check.  If roi width or height is less than minimum possible plate size,
@@ -106,70 +222,98 @@ namespace alpr
       if ((roi.width < config->minPlateSizeWidthPx) || 
           (roi.height < config->minPlateSizeHeightPx))
         continue;
-      
-      Mat cropped = frame_gray(roi);
-
-      int w = cropped.size().width;
-      int h = cropped.size().height;
-      int offset_x = roi.x;
-      int offset_y = roi.y;
-      float scale_factor = computeScaleFactor(w, h);
 
-      if (scale_factor != 1.0)
-        resize(cropped, cropped, Size(w * scale_factor, h * scale_factor));
-
-    
-      float maxWidth = ((float) w) * (config->maxPlateWidthPercent / 100.0f) * scale_factor;
-      float maxHeight = ((float) h) * (config->maxPlateHeightPercent / 100.0f) * scale_factor;
-      Size minPlateSize(config->minPlateSizeWidthPx, config->minPlateSizeHeightPx);
-      Size maxPlateSize(maxWidth, maxHeight);
-    
-      vector<Rect> allRegions = find_plates(cropped, minPlateSize, maxPlateSize);
-      
-      // Aggregate the Rect regions into a hierarchical representation
-      for( unsigned int i = 0; i < allRegions.size(); i++ )
-      {
-        allRegions[i].x = (allRegions[i].x / scale_factor);
-        allRegions[i].y = (allRegions[i].y / scale_factor);
-        allRegions[i].width = allRegions[i].width / scale_factor;
-        allRegions[i].height = allRegions[i].height / scale_factor;
+      if (mask.loaded && mask.region_is_fully_masked(roi))
+        continue;
 
-        // Ensure that the rectangle isn't < 0 or > maxWidth/Height
-        allRegions[i] = expandRect(allRegions[i], 0, 0, w, h);
+      RoiSearch search;
+      search.detector = this;
+      search.frame_gray = frame_gray;
+      search.roi = roi;
+      search.mask = mask;
+      search.failed = false;
+      searches.push_back(search);
+    }
 
-        allRegions[i].x = allRegions[i].x + offset_x;
-        allRegions[i].y = allRegions[i].y + offset_y;
-      }
-      
-      // Check the rectangles and make sure that they're definitely not masked
-      vector<Rect> regions_not_masked;
-      for (unsigned int i = 0; i < allRegions.size(); i++)
-      {
-        if (detector_mask.mask_loaded)
-        {
-          if (!detector_mask.region_is_masked(allRegions[i]))
-            regions_not_masked.push_back(allRegions[i]);
-        }
-        else
-          regions_not_masked.push_back(allRegions[i]);
-      }
-      
-      vector<PlateRegion> orderedRegions = aggregateRegions(regions_not_masked);
+    if (task_pool != NULL && searches.size() > 1)
+    {
+      TaskGroup group;
+      for (unsigned int i = 0; i < searches.size(); i++)
+        task_pool->run(&group, roiSearchTask, &searches[i]);
+      task_pool->wait(&group);
+    }
+    else
+    {
+      for (unsigned int i = 0; i < searches.size(); i++)
+        roiSearchTask(&searches[i]);
+    }
 
-      
+    // The regions are returned in the order of the regions of interest, however the searches were scheduled.
+    PlateRegions detectedRegions;
+    for (unsigned int i = 0; i < searches.size(); i++)
+    {
+      if (searches[i].failed)
+        std::rethrow_exception(searches[i].error);
 
-      for (unsigned int j = 0; j < orderedRegions.size(); j++)
-        detectedRegions.push_back(orderedRegions[j]);
+      detectedRegions.append(searches[i].regions);
     }
 
     // Show debug mask image
-    if (detector_mask.mask_loaded && config->debugDetector && config->debugShowImages)
+    if (mask.loaded && config->debugDetector && config->debugShowImages)
     {
       imshow("Detection Mask", mask_debug_img);
     }
     
     return detectedRegions;
   }
+
+  void Detector::preprocess(Mat& /*roi_gray*/)
+  {
+  }
+
+  PlateRegions Detector::detectInRoi(Mat frame_gray, Rect roi, const PreparedMask& mask)
+  {
+    float scale_factor = computeScaleFactor(roi.width, roi.height);
+
+    // Only the area being searched is prepared, rather than the whole frame.
+    Mat roi_gray = frame_gray(roi);
+    preprocess(roi_gray);
+
+    vector<Rect> allRegions;
+    if (config->detectionTiling && scale_factor < 1.0)
+      allRegions = findPlatesTiled(roi_gray, roi, scale_factor, mask);
+    else
+      allRegions = findPlatesScaled(roi_gray, roi, scale_factor);
+    
+    // Check the rectangles and make sure that they're definitely not masked
+    vector<Rect> regions_not_masked;
+    for (unsigned int i = 0; i < allRegions.size(); i++)
+    {
+      if (mask.loaded)
+      {
+        if (!mask.region_is_masked(allRegions[i]))
+          regions_not_masked.push_back(allRegions[i]);
+      }
+      else
+        regions_not_masked.push_back(allRegions[i]);
+    }
+    
+    return aggregateRegions(regions_not_masked);
+  }
+
+  void Detector::roiSearchTask(void* arg)
+  {
+    RoiSearch* search = (RoiSearch*) arg;
+    try
+    {
+      search->regions = search->detector->detectInRoi(search->frame_gray, search->roi, search->mask);
+    }
+    catch (...)
+    {
+      search->error = std::current_exception();
+      search->failed = true;
+    }
+  }
   
   std::string Detector::get_detector_file() {
     if (config->detectorFile.length() == 0)
@@ -204,58 +348,239 @@ namespace alpr
     
   }
 
+  vector<Rect> Detector::findPlatesScaled(Mat roi_gray, Rect roi, float scale_factor)
+  {
+    DetectionSearch search;
+    search.detector = this;
+    search.roi_gray = roi_gray;
+    search.origin = roi.tl();
+    search.region = roi;
+    search.owned = roi;
+    search.scale_factor = scale_factor;
+    search.min_plate_size = Size(config->minPlateSizeWidthPx, config->minPlateSizeHeightPx);
+    search.max_plate_size = Size(((float) roi.width) * (config->maxPlateWidthPercent / 100.0f) * scale_factor,
+                                 ((float) roi.height) * (config->maxPlateHeightPercent / 100.0f) * scale_factor);
+    search.failed = false;
+
+    runSearch(&search);
+    return search.plates;
+  }
+
+  vector<Rect> Detector::findPlatesTiled(Mat roi_gray, Rect roi, float scale_factor, const PreparedMask& mask)
+  {
+    // The shrunk image still finds the larger plates.  Any plate too small to be found there has to fit entirely
+    // inside the overlap between two tiles, so that one of the tiles sees all of it.
+    int tile_width = std::min(config->detectionTileWidth, roi.width);
+    int tile_height = std::min(config->detectionTileHeight, roi.height);
+    int overlap_x = std::max(config->detectionTileOverlap, (int) ceil(config->minPlateSizeWidthPx / scale_factor));
+    int overlap_y = std::max(config->detectionTileOverlap, (int) ceil(config->minPlateSizeHeightPx / scale_factor));
+    overlap_x = std::min(overlap_x, tile_width / 2);
+    overlap_y = std::min(overlap_y, tile_height / 2);
+
+    vector<int> offsets_x = tileOffsets(roi.width, tile_width, overlap_x);
+    vector<int> offsets_y = tileOffsets(roi.height, tile_height, overlap_y);
+
+    if (config->debugDetector)
+      std::cout << "Searching " << offsets_x.size() << "x" << offsets_y.size() << " tiles of " << tile_width << "x" << tile_height
+                << " at full resolution, with an overlap of " << overlap_x << "x" << overlap_y << endl;
+
+    float maxWidth = ((float) roi.width) * (config->maxPlateWidthPercent / 100.0f);
+    float maxHeight = ((float) roi.height) * (config->maxPlateHeightPercent / 100.0f);
+
+    DetectionSearch search;
+    search.detector = this;
+    search.roi_gray = roi_gray;
+    search.origin = roi.tl();
+    search.min_plate_size = Size(config->minPlateSizeWidthPx, config->minPlateSizeHeightPx);
+    search.failed = false;
+
+    // The tiles come first, since their boxes are more precise than the ones from the shrunk image.
+    vector<DetectionSearch> searches;
+    for (unsigned int ty = 0; ty < offsets_y.size(); ty++)
+    {
+      // Each tile owns the area up to the middle of its overlap with the next tile.
+      int top = (ty == 0) ? 0 : (offsets_y[ty - 1] + tile_height + offsets_y[ty]) / 2;
+      int bottom = (ty + 1 == offsets_y.size()) ? roi.height : (offsets_y[ty] + tile_height + offsets_y[ty + 1]) / 2;
+
+      for (unsigned int tx = 0; tx < offsets_x.size(); tx++)
+      {
+        int left = (tx == 0) ? 0 : (offsets_x[tx - 1] + tile_width + offsets_x[tx]) / 2;
+        int right = (tx + 1 == offsets_x.size()) ? roi.width : (offsets_x[tx] + tile_width + offsets_x[tx + 1]) / 2;
+
+        DetectionSearch tile = search;
+        tile.region = Rect(roi.x + offsets_x[tx], roi.y + offsets_y[ty], tile_width, tile_height);
+        tile.owned = Rect(roi.x + left, roi.y + top, right - left, bottom - top);
+        tile.scale_factor = 1.0;
+        tile.max_plate_size = Size(std::min(maxWidth, (float) overlap_x), std::min(maxHeight, (float) overlap_y));
+
+        // Nothing inside a masked tile would be kept.
+        if (mask.loaded && mask.region_is_fully_masked(tile.region))
+          continue;
+
+        searches.push_back(tile);
+      }
+    }
+
+    DetectionSearch shrunk = search;
+    shrunk.region = roi;
+    shrunk.owned = roi;
+    shrunk.scale_factor = scale_factor;
+    shrunk.max_plate_size = Size(maxWidth * scale_factor, maxHeight * scale_factor);
+    searches.push_back(shrunk);
+
+    if (task_pool != NULL)
+    {
+      TaskGroup group;
+      for (unsigned int i = 0; i < searches.size(); i++)
+        task_pool->run(&group, searchTask, &searches[i]);
+      task_pool->wait(&group);
+    }
+    else
+    {
+      for (unsigned int i = 0; i < searches.size(); i++)
+        searchTask(&searches[i]);
+    }
+
+    // Merge the boxes in order.  A box that matches one already kept from a different search is the same plate.
+    // Boxes from the same search are left alone, since the smaller boxes inside a plate become its children later.
+    vector<Rect> plates;
+    vector<unsigned int> plate_sources;
+    for (unsigned int i = 0; i < searches.size(); i++)
+    {
+      if (searches[i].failed)
+        std::rethrow_exception(searches[i].error);
+
+      for (unsigned int p = 0; p < searches[i].plates.size(); p++)
+      {
+        bool duplicate = false;
+        for (unsigned int k = 0; k < plates.size() && !duplicate; k++)
+        {
+          if (plate_sources[k] != i && intersectionOverUnion(plates[k], searches[i].plates[p]) > TILE_DUPLICATE_OVERLAP)
+            duplicate = true;
+        }
+
+        if (!duplicate)
+        {
+          plates.push_back(searches[i].plates[p]);
+          plate_sources.push_back(i);
+        }
+      }
+    }
+
+    return plates;
+  }
+
   bool rectHasLargerArea(cv::Rect a, cv::Rect b) { return a.area() < b.area(); };
 
-  vector<PlateRegion> Detector::aggregateRegions(vector<Rect> regions)
+  // The grid over the region centers has at most this many cells in each direction.
+  const int MAX_GRID_CELLS = 64;
+
+  PlateRegions Detector::aggregateRegions(const vector<Rect>& regions)
   {
     // Combines overlapping regions into a parent->child order.
     // The largest regions will be parents, and they will have children if they are within them.
     // This way, when processing regions later, we can process the parents first, and only delve into the children
     // If there was no plate match.  Otherwise, we would process everything and that would be wasteful.
+    //
+    // Each region's parent is the smallest larger region that contains its center.  The centers are kept in a grid, so
+    // each region only looks at the centers near it.
+
+    PlateRegions tree;
+    if (regions.size() == 0)
+      return tree;
+
+    // Sort the list of rect regions smallest to largest.  Regions of the same size keep the detector's order.
+    vector<Rect> ordered = regions;
+    std::stable_sort(ordered.begin(), ordered.end(), rectHasLargerArea);
+    int count = ordered.size();
+
+    tree.regions.resize(count);
+    vector<Point> centers(count);
+    int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+    double total_width = 0, total_height = 0;
+    for (int i = 0; i < count; i++)
+    {
+      tree.regions[i].rect = ordered[i];
+      tree.regions[i].first_child = -1;
+      tree.regions[i].next_sibling = -1;
+
+      centers[i] = Point(ordered[i].x + (ordered[i].width / 2), ordered[i].y + (ordered[i].height / 2));
+      min_x = std::min(min_x, centers[i].x);
+      min_y = std::min(min_y, centers[i].y);
+      max_x = std::max(max_x, centers[i].x);
+      max_y = std::max(max_y, centers[i].y);
+      total_width += ordered[i].width;
+      total_height += ordered[i].height;
+    }
 
-    vector<PlateRegion> orderedRegions;
-    vector<PlateRegion> topLevelRegions;
-
-    // Sort the list of rect regions smallest to largest
-    std::sort(regions.begin(), regions.end(), rectHasLargerArea);
-
-    // Create new PlateRegions and attach the rectangles to each
-    for (unsigned int i = 0; i < regions.size(); i++)
+    // A cell about the size of an average region, so a region only covers a few cells.
+    int cell_width = std::max(1, (int) (total_width / count));
+    int cell_height = std::max(1, (int) (total_height / count));
+    cell_width = std::max(cell_width, ((max_x - min_x) / MAX_GRID_CELLS) + 1);
+    cell_height = std::max(cell_height, ((max_y - min_y) / MAX_GRID_CELLS) + 1);
+    int grid_cols = ((max_x - min_x) / cell_width) + 1;
+    int grid_rows = ((max_y - min_y) / cell_height) + 1;
+
+    // Each cell lists the regions centered inside it, smallest first.
+    vector<vector<int> > grid(grid_cols * grid_rows);
+    for (int i = 0; i < count; i++)
     {
-      PlateRegion newRegion;
-      newRegion.rect = regions[i];
-      orderedRegions.push_back(newRegion);
+      int col = (centers[i].x - min_x) / cell_width;
+      int row = (centers[i].y - min_y) / cell_height;
+      grid[(row * grid_cols) + col].push_back(i);
     }
 
-    for (unsigned int i = 0; i < orderedRegions.size(); i++)
+    // Going from smallest to largest, each region takes the centers inside it that haven't found a parent yet.
+    // A region can only be the parent of smaller regions, which come before it.
+    vector<int> parents(count, -1);
+    vector<int> last_child(count, -1);
+    for (int k = 0; k < count; k++)
     {
-      bool foundParent = false;
-      for (unsigned int k = i + 1; k < orderedRegions.size(); k++)
-      {
-        Point center( orderedRegions[i].rect.x + (orderedRegions[i].rect.width / 2),
-                      orderedRegions[i].rect.y + (orderedRegions[i].rect.height / 2));
+      const Rect& parent = ordered[k];
+      int first_col = std::max(0, (parent.x - min_x) / cell_width);
+      int last_col = std::min(grid_cols - 1, (parent.x + parent.width - 1 - min_x) / cell_width);
+      int first_row = std::max(0, (parent.y - min_y) / cell_height);
+      int last_row = std::min(grid_rows - 1, (parent.y + parent.height - 1 - min_y) / cell_height);
 
-        // Check if the center of the smaller rectangle is inside the bigger rectangle.
-        // If so, add it to the children and continue on.
-        if (orderedRegions[k].rect.contains(center))
+      for (int row = first_row; row <= last_row; row++)
+      {
+        for (int col = first_col; col <= last_col; col++)
         {
-          orderedRegions[k].children.push_back(orderedRegions[i]);
-          foundParent = true;
-          break;
+          // The regions that find a parent are removed from the cell as it is scanned.
+          vector<int>& cell = grid[(row * grid_cols) + col];
+          unsigned int kept = 0;
+          for (unsigned int c = 0; c < cell.size(); c++)
+          {
+            int i = cell[c];
+            if (i < k && parent.contains(centers[i]))
+              parents[i] = k;
+            else
+              cell[kept++] = i;
+          }
+          cell.resize(kept);
         }
-
       }
+    }
 
-      if (foundParent == false)
+    // Link the children in order, smallest first, and collect the regions that have no parent.
+    for (int i = 0; i < count; i++)
+    {
+      int k = parents[i];
+      if (k < 0)
       {
         // We didn't find any parents for this rectangle.  Add it to the top level regions
-        topLevelRegions.push_back(orderedRegions[i]);
+        tree.top_level.push_back(i);
+        continue;
       }
 
+      if (last_child[k] < 0)
+        tree.regions[k].first_child = i;
+      else
+        tree.regions[last_child[k]].next_sibling = i;
+      last_child[k] = i;
     }
 
-
-    return topLevelRegions;
+    return tree;
   }
 
 }
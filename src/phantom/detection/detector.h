@@ -27,6 +27,7 @@
 #include "utility.h"
 #include "detector_types.h"
 #include "support/timing.h"
+#include "support/taskpool.h"
 #include "constants.h"
 #include "detectormask.h"
 #include "prewarp.h"
@@ -44,12 +45,21 @@ namespace alpr
       virtual ~Detector();
 
       bool isLoaded();
-      std::vector<PlateRegion> detect(cv::Mat frame);
-      std::vector<PlateRegion> detect(cv::Mat frame, std::vector<cv::Rect> regionsOfInterest);
+      PlateRegions detect(cv::Mat frame);
+      PlateRegions detect(cv::Mat frame, std::vector<cv::Rect> regionsOfInterest);
 
+      // Prepares one region of interest of the gray frame for find_plates.  Each region is prepared once, and its tiles
+      // share it.  The region shares pixels with the caller's image, so it has to be replaced rather than changed in place.
+      virtual void preprocess(cv::Mat& roi_gray);
+
+      // May be called on several parts of the same frame at once, so the frame must not be modified.
       virtual std::vector<cv::Rect> find_plates(cv::Mat frame, cv::Size min_plate_size, cv::Size max_plate_size)=0;
       
       void setMask(cv::Mat mask);
+
+      // The regions of interest, and with detection_tiling the tiles of large images, are searched in parallel on the pool.
+      // Without a pool, they are searched one after another.
+      void setTaskPool(TaskPool* task_pool);
       
     protected:
       Config* config;
@@ -58,10 +68,20 @@ namespace alpr
       
       DetectorMask detector_mask;
 
+      TaskPool* task_pool;
+
       std::string get_detector_file();
       
       float computeScaleFactor(int width, int height);
-      std::vector<PlateRegion> aggregateRegions(std::vector<cv::Rect> regions);
+
+      PlateRegions detectInRoi(cv::Mat frame_gray, cv::Rect roi, const PreparedMask& mask);
+      static void roiSearchTask(void* arg);
+
+      // Both return the plates found inside the region of interest, in frame coordinates.
+      // 'roi_gray' is the prepared region of interest, and 'roi' is where it is in the frame.
+      std::vector<cv::Rect> findPlatesScaled(cv::Mat roi_gray, cv::Rect roi, float scale_factor);
+      std::vector<cv::Rect> findPlatesTiled(cv::Mat roi_gray, cv::Rect roi, float scale_factor, const PreparedMask& mask);
+      PlateRegions aggregateRegions(const std::vector<cv::Rect>& regions);
 
 
 
@@ -20,13 +20,61 @@
 #ifndef OPENALPR_DETECTOR_TYPES_H
 #define	OPENALPR_DETECTOR_TYPES_H
 
+#include <vector>
+#include "opencv2/core/core.hpp"
+
 namespace alpr
 {
   
+  // A region that may contain a plate.  The regions are kept in a flat list (PlateRegions), and refer to their
+  // children by their index in the list.
   struct PlateRegion
   {
     cv::Rect rect;
-    std::vector<PlateRegion> children;
+    int first_child; // -1 when the region has no children.
+    int next_sibling; // The next child of the same parent, or -1.
+  };
+  
+  // The regions found by the detector, arranged so that the smaller regions centered inside a region are its children.
+  // The top level regions are analyzed first, and the children of a region only if no plate was read from it.
+  struct PlateRegions
+  {
+    std::vector<PlateRegion> regions;
+    std::vector<int> top_level; // Indices into 'regions'.
+    
+    // Adds a top level region without children.  Returns its index.
+    int add(cv::Rect rect)
+    {
+      PlateRegion region;
+      region.rect = rect;
+      region.first_child = -1;
+      region.next_sibling = -1;
+      regions.push_back(region);
+      top_level.push_back(regions.size() - 1);
+      return regions.size() - 1;
+    }
+    
+    // Adds the regions of another tree after these ones.
+    void append(const PlateRegions& other)
+    {
+      int offset = regions.size();
+      for (unsigned int i = 0; i < other.regions.size(); i++)
+      {
+        PlateRegion region = other.regions[i];
+        if (region.first_child >= 0)
+          region.first_child += offset;
+        if (region.next_sibling >= 0)
+          region.next_sibling += offset;
+        regions.push_back(region);
+      }
+      for (unsigned int i = 0; i < other.top_level.size(); i++)
+        top_level.push_back(other.top_level[i] + offset);
+    }
+    
+    const cv::Rect& topLevelRect(unsigned int i) const
+    {
+      return regions[top_level[i]].rect;
+    }
   };
   
 }
@@ -18,6 +18,7 @@
 */
 
 #include "detectorcpu.h"
+#include "stats.h"
 
 #include <stdio.h>
 
@@ -32,9 +33,13 @@ namespace alpr
 
 
     
-    if( this->plate_cascade.load( get_detector_file() ) )
+    cv::CascadeClassifier* plate_cascade = new cv::CascadeClassifier();
+    all_cascades.push_back(plate_cascade);
+
+    if( plate_cascade->load( get_detector_file() ) )
     {
       this->loaded = true;
+      idle_cascades.push_back(plate_cascade);
     }
     else
     {
@@ -45,11 +50,46 @@ namespace alpr
 
 
   DetectorCPU::~DetectorCPU() {
+    for (unsigned int i = 0; i < all_cascades.size(); i++)
+      delete all_cascades[i];
+  }
+
+  cv::CascadeClassifier* DetectorCPU::checkoutCascade()
+  {
+    {
+      tthread::lock_guard<tthread::mutex> guard(cascade_mutex);
+      if (idle_cascades.size() > 0)
+      {
+        cv::CascadeClassifier* cascade = idle_cascades.back();
+        idle_cascades.pop_back();
+        return cascade;
+      }
+    }
+
+    cv::CascadeClassifier* cascade = new cv::CascadeClassifier();
+    cascade->load( get_detector_file() );
+
+    tthread::lock_guard<tthread::mutex> guard(cascade_mutex);
+    all_cascades.push_back(cascade);
+    return cascade;
+  }
+
+  void DetectorCPU::checkinCascade(cv::CascadeClassifier* cascade)
+  {
+    tthread::lock_guard<tthread::mutex> guard(cascade_mutex);
+    idle_cascades.push_back(cascade);
   }
 
 
 
   
+  void DetectorCPU::preprocess(Mat& roi_gray)
+  {
+    Mat equalized;
+    equalizeHist( roi_gray, equalized );
+    roi_gray = equalized;
+  }
+
   vector<Rect> DetectorCPU::find_plates(Mat frame, cv::Size min_plate_size, cv::Size max_plate_size)
   {
 
@@ -59,20 +99,23 @@ namespace alpr
     timespec startTime;
     getTimeMonotonic(&startTime);
 
-    equalizeHist( frame, frame );
-    
-    plate_cascade.detectMultiScale( frame, plates, config->detection_iteration_increase, config->detectionStrictness,
-                                      CASCADE_DO_CANNY_PRUNING,
-                                      //0|CV_HAAR_SCALE_IMAGE,
-                                      min_plate_size, max_plate_size );
-
-
-    if (config->debugTiming)
+    cv::CascadeClassifier* plate_cascade = checkoutCascade();
+    try
+    {
+      plate_cascade->detectMultiScale( frame, plates, config->detection_iteration_increase, config->detectionStrictness,
+                                        CASCADE_DO_CANNY_PRUNING,
+                                        //0|CV_HAAR_SCALE_IMAGE,
+                                        min_plate_size, max_plate_size );
+    }
+    catch (cv::Exception& e)
     {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "LBP Time: " << diffclock(startTime, endTime) << "ms." << endl;
+      checkinCascade(plate_cascade);
+      throw;
     }
+    checkinCascade(plate_cascade);
+
+
+    recordStageTime(config, STAGE_DETECTION, startTime);
 
     return plates;
 
@@ -28,6 +28,7 @@
 #include "opencv2/ml/ml.hpp"
 
 #include "detector.h"
+#include "support/tinythread.h"
 
 namespace alpr
 {
@@ -37,11 +38,19 @@ namespace alpr
       DetectorCPU(Config* config, PreWarp* prewarp);
       virtual ~DetectorCPU();
 
+      void preprocess(cv::Mat& roi_gray);
       std::vector<cv::Rect> find_plates(cv::Mat frame, cv::Size min_plate_size, cv::Size max_plate_size);
       
   private:
 
-      cv::CascadeClassifier plate_cascade;
+      // A cascade classifier keeps scratch buffers while it runs, so concurrent calls each use their own.
+      // Additional classifiers are loaded the first time they are needed.
+      cv::CascadeClassifier* checkoutCascade();
+      void checkinCascade(cv::CascadeClassifier* cascade);
+
+      std::vector<cv::CascadeClassifier*> all_cascades;
+      std::vector<cv::CascadeClassifier*> idle_cascades;
+      tthread::mutex cascade_mutex;
 
   };
 
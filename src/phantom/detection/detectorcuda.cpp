@@ -18,6 +18,7 @@
 */
 
 #include "detectorcuda.h"
+#include "stats.h"
 
 #ifdef COMPILE_GPU
 
@@ -67,6 +68,8 @@ namespace alpr
 #endif
     Mat plateregions_downloaded;
 
+    tthread::lock_guard<tthread::mutex> guard(cascade_mutex);
+
     cudaFrame.upload(frame);
 #if OPENCV_MAJOR_VERSION == 2
     int numdetected = cuda_cascade.detectMultiScale(cudaFrame, plateregions_buffer, 
@@ -90,12 +93,7 @@ namespace alpr
       plates.push_back(plateregions_downloaded.ptr<cv::Rect>()[i]);
     }
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "LBP Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_DETECTION, startTime);
     
     return plates;
   }
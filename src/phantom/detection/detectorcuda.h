@@ -37,6 +37,7 @@
 
 #include "detector.h"
 #include "detectorcpu.h"
+#include "support/tinythread.h"
 
 
 
@@ -57,6 +58,9 @@ namespace alpr
 #else
       cv::Ptr<cv::cuda::CascadeClassifier> cuda_cascade;
 #endif
+
+      // The GPU classifier is configured and run as a single step, so concurrent calls take turns.
+      tthread::mutex cascade_mutex;
   };
 
 }
@@ -22,26 +22,32 @@
 
 using namespace cv;
 using namespace std;
-  
 namespace alpr
 {
   
 
+  PreparedMask::PreparedMask() {
+    loaded = false;
+    debug = false;
+  }
+
   DetectorMask::DetectorMask(Config* config, PreWarp* prewarp) {
     mask_loaded = false;
-    resized_mask_loaded = false;
     this->config = config;
     this->prewarp = prewarp;
-    last_prewarp_hash = "";
+    last_prewarp_version = 0;
   }
 
   DetectorMask::~DetectorMask() {
   }
 
   void DetectorMask::setMask(Mat orig_mask) {
+    tthread::lock_guard<tthread::mutex> guard(mask_mutex);
+
+    prepared = PreparedMask();
+
     if (orig_mask.cols <= 0 || orig_mask.rows <= 0)
     {
-      resized_mask_loaded = false;
       mask_loaded = false;
       return;
     }
@@ -52,19 +58,40 @@ namespace alpr
     else
       this->mask = orig_mask;
     
-    resized_mask_loaded = false;
     mask_loaded = true;
   }
   
+  PreparedMask DetectorMask::prepare(cv::Size frame_size) {
+    tthread::lock_guard<tthread::mutex> guard(mask_mutex);
+
+    if (!mask_loaded)
+      return PreparedMask();
+
+    if (!prepared.loaded || frame_size != prepared.resized_mask.size() || 
+            last_prewarp_version != prewarp->version)
+    {
+      // Detections still using the previous mask hold their own reference to it, so it's replaced rather than refilled.
+      prepared = resize_mask(frame_size);
+      
+      last_prewarp_version = prewarp->version;
+    }
+    
+    return prepared;
+  }
+  
   cv::Size DetectorMask::mask_size() {
-    if (resized_mask_loaded)
-      return resized_mask.size();
+    tthread::lock_guard<tthread::mutex> guard(mask_mutex);
+    if (prepared.loaded)
+      return prepared.resized_mask.size();
     return mask.size();
   }
 
   // Provided a region of interest, truncate it if the mask cuts off a portion of it.
   // No reason to analyze extra content
-  cv::Rect DetectorMask::getRoiInsideMask(cv::Rect roi) {
+  cv::Rect PreparedMask::getRoiInsideMask(cv::Rect roi) const {
+      if (!loaded)
+        return roi;
+      
       Rect roi_intersection = roi & scan_area;
       return roi_intersection;  
   }
@@ -72,91 +99,112 @@ namespace alpr
   
   // Checks if the provided region is partially covered by the mask
   // If so, it is disqualified
-  bool DetectorMask::region_is_masked(cv::Rect region) {
+  bool PreparedMask::region_is_masked(cv::Rect region) const {
     int MIN_WHITENESS = 248;
+
+    if (!loaded)
+      return false;
     
     // If the mean pixel value over the crop is very white (e.g., > 253 out of 255)
     // then this is in the white area of the mask and we'll use it
     
     // Make sure the region doesn't extend beyond the bounds of our image
-    expandRect(region, 0, 0, resized_mask.cols, resized_mask.rows);
-    Mat mask_crop = resized_mask(region);
-    double mean_value = mean(mask_crop)[0];
+    region = expandRect(region, 0, 0, resized_mask.cols, resized_mask.rows);
+    if (region.area() <= 0)
+      return true;
+    
+    double mean_value = (255.0 * unmasked_pixels(region)) / region.area();
     
-    if (config->debugDetector)
+    if (debug)
     {
       cout << "region_is_masked: Mean whiteness: " << mean_value << endl;
     }
     return mean_value < MIN_WHITENESS;
   }
   
-  void DetectorMask::resize_mask(cv::Mat image) {
+  // Regions that are masked entirely don't need to be searched at all.
+  bool PreparedMask::region_is_fully_masked(cv::Rect region) const {
+    if (!loaded)
+      return false;
+    
+    region = expandRect(region, 0, 0, resized_mask.cols, resized_mask.rows);
+    if (region.area() <= 0)
+      return true;
+    
+    return unmasked_pixels(region) == 0;
+  }
+  
+  int64_t PreparedMask::unmasked_pixels(cv::Rect region) const {
+    int top = region.y, bottom = region.y + region.height;
+    int left = region.x, right = region.x + region.width;
+    
+    return (int64_t) mask_integral.at<int>(bottom, right) - mask_integral.at<int>(top, right)
+           - mask_integral.at<int>(bottom, left) + mask_integral.at<int>(top, left);
+  }
+  
+  PreparedMask DetectorMask::resize_mask(cv::Size frame_size) {
     
-    resize(mask, resized_mask, image.size());
+    PreparedMask fitted;
+    fitted.loaded = true;
+    fitted.debug = config->debugDetector;
+    
+    resize(mask, fitted.resized_mask, frame_size);
 
     if (prewarp->valid) 
     {
-      resized_mask = prewarp->warpImage(resized_mask);
+      fitted.resized_mask = prewarp->warpImage(fitted.resized_mask);
     }
 
     // Threshold the mask so that the values are either 0 or 255 (no shades of gray))
     // This can happen with jpeg compression
-    threshold(this->mask, this->mask, 55, 255, cv::THRESH_BINARY);
+    threshold(fitted.resized_mask, fitted.resized_mask, 55, 255, cv::THRESH_BINARY);
+    
+    // Count each unmasked pixel as 1, so the integral image holds the number of unmasked pixels above and to the left.
+    Mat unmasked;
+    threshold(fitted.resized_mask, unmasked, 127, 1, cv::THRESH_BINARY);
+    integral(unmasked, fitted.mask_integral, CV_32S);
      
     // Calculate the biggest rectangle that covers all the whitespace
-    // Rather than using contours, go row by row, column by column until you hit
-    // a white pixel and stop.  Should be faster and a little simpler
+    // Go row by row, column by column until you hit a white pixel and stop.
+    // Each row and column is counted from the integral image.
     int top_bound = 0, bottom_bound = 0, left_bound = 0, right_bound = 0;
+    int rows = fitted.resized_mask.rows, cols = fitted.resized_mask.cols;
     
-    for (top_bound = 0; top_bound < resized_mask.rows; top_bound++)
-      if (countNonZero(resized_mask.row(top_bound)) > 0) break;
-    for (bottom_bound = resized_mask.rows - 1; bottom_bound >= 0; bottom_bound--)
-      if (countNonZero(resized_mask.row(bottom_bound)) > 0) break;
+    for (top_bound = 0; top_bound < rows; top_bound++)
+      if (fitted.unmasked_pixels(Rect(0, top_bound, cols, 1)) > 0) break;
+    for (bottom_bound = rows - 1; bottom_bound >= 0; bottom_bound--)
+      if (fitted.unmasked_pixels(Rect(0, bottom_bound, cols, 1)) > 0) break;
     
-    for (left_bound = 0; left_bound < resized_mask.cols; left_bound++)
-      if (countNonZero(resized_mask.col(left_bound)) > 0) break;
-    for (right_bound = resized_mask.cols - 1; right_bound >= 0; right_bound--)
-      if (countNonZero(resized_mask.col(right_bound)) > 0) break;
+    for (left_bound = 0; left_bound < cols; left_bound++)
+      if (fitted.unmasked_pixels(Rect(left_bound, 0, 1, rows)) > 0) break;
+    for (right_bound = cols - 1; right_bound >= 0; right_bound--)
+      if (fitted.unmasked_pixels(Rect(right_bound, 0, 1, rows)) > 0) break;
     
-    if (left_bound >= right_bound || top_bound >= bottom_bound)
+    if (left_bound > right_bound || top_bound > bottom_bound)
     {
       // Invalid mask, set it to 0 width/height
-      scan_area.x = 0;
-      scan_area.y = 0;
-      scan_area.width = 0;
-      scan_area.height = 0;
+      fitted.scan_area.x = 0;
+      fitted.scan_area.y = 0;
+      fitted.scan_area.width = 0;
+      fitted.scan_area.height = 0;
     }
     else
     {
-      scan_area.x = left_bound;
-      scan_area.y = top_bound;
-      scan_area.width = right_bound - left_bound;
-      scan_area.height = bottom_bound - top_bound;
+      fitted.scan_area.x = left_bound;
+      fitted.scan_area.y = top_bound;
+      fitted.scan_area.width = right_bound - left_bound + 1;
+      fitted.scan_area.height = bottom_bound - top_bound + 1;
     }
       
     //cout << scan_area << endl;
+    
+    return fitted;
   }
 
-  Mat DetectorMask::apply_mask(Mat image) {
-    if (!mask_loaded)
+  Mat PreparedMask::apply_mask(Mat image) const {
+    if (!loaded)
       return image;
-       
-    if (!resized_mask_loaded || image.size() != resized_mask.size() || 
-            last_prewarp_hash != prewarp->toString())
-    {
-      resize_mask(image);
-      
-      last_prewarp_hash = prewarp->toString();
-      
-      resized_mask_loaded = true;
-    }
-    
-    if (image.size() != resized_mask.size() && config->debugDetector)
-    {
-      cout << "Mask does not match image size" << endl;
-      return image;
-    }
-    
+
     Mat response = Mat::zeros(image.size(), image.type());
     bitwise_and(image, resized_mask, response);
     
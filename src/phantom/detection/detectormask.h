@@ -24,10 +24,47 @@
 #include "opencv2/imgproc/imgproc.hpp"
 #include "config.h"
 #include "prewarp.h"
+#include "support/tinythread.h"
 
 namespace alpr
 {
 
+  // The mask fitted to one frame size.  It is never changed once it's built, so a detection keeps using the one it
+  // was given while other detections fit the mask to other frame sizes.
+  class PreparedMask {
+  public:
+
+    PreparedMask();
+
+    // False when no mask has been specified.  Nothing is masked then.
+    bool loaded;
+
+    cv::Rect getRoiInsideMask(cv::Rect roi) const;
+
+    // Both take a constant time, whatever the size of the region.
+    bool region_is_masked(cv::Rect region) const;
+    bool region_is_fully_masked(cv::Rect region) const;
+
+    // Returns a copy of the image with the masked area blacked out, for debugging.
+    cv::Mat apply_mask(cv::Mat image) const;
+
+  private:
+
+    friend class DetectorMask;
+
+    // The number of unmasked pixels in the region, which must be inside the mask.
+    int64_t unmasked_pixels(cv::Rect region) const;
+
+    cv::Mat resized_mask;
+
+    // The integral image of the resized mask, counting unmasked pixels.  One row and column larger than the mask.
+    cv::Mat mask_integral;
+
+    cv::Rect scan_area;
+
+    bool debug;
+  };
+
   class DetectorMask {
   public:
     
@@ -36,30 +73,29 @@ namespace alpr
 
     void setMask(cv::Mat mask);
     
-    cv::Rect getRoiInsideMask(cv::Rect roi);
+    // Returns the mask fitted to frames of this size.  The last one is reused until the frame size, the mask or the
+    // prewarp changes.
+    PreparedMask prepare(cv::Size frame_size);
     
     cv::Size mask_size();
     
-    bool region_is_masked(cv::Rect region);
-    
-    cv::Mat apply_mask(cv::Mat image);
-    
     bool mask_loaded;
     
   private:
 
-    void resize_mask(cv::Mat image);
+    PreparedMask resize_mask(cv::Size frame_size);
     
     PreWarp* prewarp;
-    std::string last_prewarp_hash;
+    unsigned int last_prewarp_version;
     
     cv::Mat mask;
     
-    cv::Mat resized_mask;
-    bool resized_mask_loaded;
+    PreparedMask prepared;
     
     Config* config;
-    cv::Rect scan_area;
+
+    // The prepared mask is replaced by whichever detection call first sees a new frame size.
+    tthread::mutex mask_mutex;
    
   };
 
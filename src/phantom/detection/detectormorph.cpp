@@ -50,17 +50,17 @@ namespace alpr {
   std::vector<cv::Rect> DetectorMorph::find_plates(cv::Mat frame_gray, cv::Size min_plate_size, cv::Size max_plate_size)
   {
 
-    Mat frame_gray_cp(frame_gray.size(), frame_gray.type());
-    frame_gray.copyTo(frame_gray_cp);
-    blur(frame_gray, frame_gray, Size(5, 5));
+    // The frame may be shared with other searches, so it is left untouched.
+    Mat frame_blurred;
+    blur(frame_gray, frame_blurred, Size(5, 5));
 
     vector<Rect> plates;
     
     Mat img_open, img_result;
     Mat element = getStructuringElement(MORPH_RECT, Size(30, 4));
-    morphologyEx(frame_gray, img_open, MORPH_OPEN, element, cv::Point(-1, -1));
+    morphologyEx(frame_blurred, img_open, MORPH_OPEN, element, cv::Point(-1, -1));
 
-    img_result = frame_gray - img_open;
+    img_result = frame_blurred - img_open;
 
     if (config->debugDetector && config->debugShowImages) {
       imshow("Opening", img_result);
@@ -143,7 +143,7 @@ namespace alpr {
       // get the rotation matrix
       Mat M = getRotationMatrix2D(PlateRect.center, PlateRect.angle, 1.0);
       // perform the affine transformation
-      warpAffine(frame_gray_cp, rotated, M, frame_gray_cp.size(), INTER_CUBIC);
+      warpAffine(frame_gray, rotated, M, frame_gray.size(), INTER_CUBIC);
       //Crop area around candidate plate
       getRectSubPix(rotated, rect_size, PlateRect.center, img_crop);
 
@@ -18,6 +18,7 @@
 */
 
 #include "detectorocl.h"
+#include "stats.h"
 #include <support/tinythread.h>
 
 #if OPENCV_MAJOR_VERSION >= 3
@@ -97,6 +98,13 @@ namespace alpr
   }
 
 
+  void DetectorOCL::preprocess(Mat& roi_gray)
+  {
+    Mat equalized;
+    equalizeHist( roi_gray, equalized );
+    roi_gray = equalized;
+  }
+
   vector<Rect> DetectorOCL::find_plates(Mat orig_frame, cv::Size min_plate_size, cv::Size max_plate_size)
   {
 
@@ -107,14 +115,14 @@ namespace alpr
     timespec startTime;
     getTimeMonotonic(&startTime);
 
+    tthread::lock_guard<tthread::mutex> guard(cascade_mutex);
+
     // If we have an OpenCL core available, use it.  Otherwise use CPU
     if (ocl_detector_mutex_m.try_lock())
     {
       UMat openclFrame;
       orig_frame.copyTo(openclFrame);
 
-      equalizeHist( openclFrame, openclFrame );
-
       plate_cascade.detectMultiScale( openclFrame, plates, config->detection_iteration_increase, config->detectionStrictness,
                                       CASCADE_DO_CANNY_PRUNING,
                                       min_plate_size, max_plate_size );
@@ -123,20 +131,13 @@ namespace alpr
     }
     else
     {
-      equalizeHist( orig_frame, orig_frame );
-
       plate_cascade.detectMultiScale( orig_frame, plates, config->detection_iteration_increase, config->detectionStrictness,
                                       CASCADE_DO_CANNY_PRUNING,
                                       min_plate_size, max_plate_size );
     }
 
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "LBP Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_DETECTION, startTime);
 
     return plates;
 
@@ -31,6 +31,7 @@
 #include "opencv2/core/ocl.hpp"
 
 #include "detector.h"
+#include "support/tinythread.h"
 
 namespace alpr
 {
@@ -40,12 +41,16 @@ namespace alpr
     DetectorOCL(Config* config, PreWarp* prewarp);
     virtual ~DetectorOCL();
 
+    void preprocess(cv::Mat& roi_gray);
     std::vector<cv::Rect> find_plates(cv::Mat frame, cv::Size min_plate_size, cv::Size max_plate_size);
 
   private:
 
     cv::CascadeClassifier plate_cascade;
 
+    // Guards the classifier, which keeps scratch buffers while it runs.
+    tthread::mutex cascade_mutex;
+
   };
 
 }
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "detectionscheduler.h"
+#include "stats.h"
+#include "utility.h"
+
+using namespace cv;
+using namespace std;
+
+namespace alpr
+{
+
+  // The scene has changed when a small thumbnail of the frame differs from the last one by this much on average (0-255).
+  const double SCENE_CHANGE_THRESHOLD = 40;
+  const int THUMBNAIL_WIDTH = 32;
+  const int THUMBNAIL_HEIGHT = 18;
+
+  DetectionScheduler::DetectionScheduler(int full_scan_interval, float window_expansion)
+  {
+    setSchedule(full_scan_interval, window_expansion);
+    full_scans = 0;
+    partial_scans = 0;
+    reset();
+  }
+
+  DetectionScheduler::~DetectionScheduler()
+  {
+  }
+
+  void DetectionScheduler::setSchedule(int full_scan_interval, float window_expansion)
+  {
+    tthread::lock_guard<tthread::mutex> guard(mutex);
+    this->full_scan_interval = std::max(full_scan_interval, 1);
+    this->window_expansion = std::max(window_expansion, 0.0f);
+  }
+
+  void DetectionScheduler::reset()
+  {
+    tthread::lock_guard<tthread::mutex> guard(mutex);
+    frames_since_full_scan = -1;
+    last_thumbnail = Mat();
+    plate_windows.clear();
+  }
+
+  vector<Rect> DetectionScheduler::schedule(const Mat& frame, const vector<Rect>& regions, bool motion)
+  {
+    tthread::lock_guard<tthread::mutex> guard(mutex);
+
+    bool changed = sceneChanged(frame);
+    if (frames_since_full_scan < 0 || changed || frames_since_full_scan + 1 >= full_scan_interval)
+    {
+      frames_since_full_scan = 0;
+      full_scans++;
+      incrementCounter(COUNTER_FULL_SCANS);
+      return regions;
+    }
+
+    frames_since_full_scan++;
+    partial_scans++;
+    incrementCounter(COUNTER_PARTIAL_SCANS);
+
+    vector<Rect> windows = plate_windows;
+    if (motion)
+      windows.insert(windows.end(), regions.begin(), regions.end());
+    return mergeOverlappingRects(windows);
+  }
+
+  void DetectionScheduler::update(const AlprResults& results)
+  {
+    // Frames with nothing to search weren't analyzed, so they say nothing about where the plates are.
+    if (results.regionsOfInterest.size() == 0)
+      return;
+
+    tthread::lock_guard<tthread::mutex> guard(mutex);
+
+    Rect image_bounds(0, 0, results.img_width, results.img_height);
+
+    vector<Rect> windows;
+    for (unsigned int i = 0; i < results.plates.size(); i++)
+    {
+      const AlprCoordinate* points = results.plates[i].plate_points;
+      int left = points[0].x, right = points[0].x, top = points[0].y, bottom = points[0].y;
+      for (int p = 1; p < 4; p++)
+      {
+        left = std::min(left, points[p].x);
+        right = std::max(right, points[p].x);
+        top = std::min(top, points[p].y);
+        bottom = std::max(bottom, points[p].y);
+      }
+
+      int expand_x = (int) ((right - left) * window_expansion);
+      int expand_y = (int) ((bottom - top) * window_expansion);
+      Rect window(left - expand_x, top - expand_y, (right - left) + (2 * expand_x), (bottom - top) + (2 * expand_y));
+      window = window & image_bounds;
+      if (window.area() > 0)
+        windows.push_back(window);
+    }
+
+    plate_windows = mergeOverlappingRects(windows);
+  }
+
+  int64_t DetectionScheduler::fullScans()
+  {
+    tthread::lock_guard<tthread::mutex> guard(mutex);
+    return full_scans;
+  }
+
+  int64_t DetectionScheduler::partialScans()
+  {
+    tthread::lock_guard<tthread::mutex> guard(mutex);
+    return partial_scans;
+  }
+
+  bool DetectionScheduler::sceneChanged(const Mat& frame)
+  {
+    if (full_scan_interval == 1 || frame.empty())
+      return false;
+
+    Mat thumbnail;
+    resize(frame, thumbnail, Size(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT), 0, 0, INTER_AREA);
+
+    bool changed = true;
+    if (last_thumbnail.size() == thumbnail.size() && last_thumbnail.type() == thumbnail.type())
+    {
+      double difference = norm(thumbnail, last_thumbnail, NORM_L1) / (double) (thumbnail.total() * thumbnail.channels());
+      changed = (difference > SCENE_CHANGE_THRESHOLD);
+    }
+
+    last_thumbnail = thumbnail;
+    return changed;
+  }
+
+}
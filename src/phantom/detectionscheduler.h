@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_DETECTIONSCHEDULER_H
+#define OPENALPR_DETECTIONSCHEDULER_H
+
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "alpr.h"
+#include "support/tinythread.h"
+
+namespace alpr
+{
+
+  // Decides which parts of each video frame are searched for plates.  Plates only move a few pixels from one frame to
+  // the next, so the regions the caller would normally search (the whole frame, or the area with motion) are only
+  // searched every few frames, and whenever the scene changes.  The frames in between only search windows around the
+  // plates found last time, along with any motion.
+  //
+  // schedule() and update() may be called from different threads, as long as the results passed to update() are in
+  // frame order.
+  class DetectionScheduler
+  {
+    public:
+      // A full scan every 'full_scan_interval' frames.  1 scans every frame in full.  Each window extends past the plate
+      // by 'window_expansion' times the plate's width and height on every side.
+      DetectionScheduler(int full_scan_interval = 1, float window_expansion = 1.0f);
+      virtual ~DetectionScheduler();
+
+      void setSchedule(int full_scan_interval, float window_expansion);
+
+      // Starts over with a full scan, for a new video.
+      void reset();
+
+      // Returns the regions to search in this frame.  'regions' are the ones the caller would search without the
+      // scheduler, and 'motion' is set when they come from motion detection rather than covering the whole frame.
+      std::vector<cv::Rect> schedule(const cv::Mat& frame, const std::vector<cv::Rect>& regions, bool motion);
+
+      // Records where plates were found in the last frame that was analyzed.
+      void update(const AlprResults& results);
+
+      int64_t fullScans();
+      int64_t partialScans();
+
+    private:
+      bool sceneChanged(const cv::Mat& frame);
+
+      int full_scan_interval;
+      float window_expansion;
+
+      int frames_since_full_scan;
+      cv::Mat last_thumbnail;
+      std::vector<cv::Rect> plate_windows;
+
+      int64_t full_scans;
+      int64_t partial_scans;
+
+      tthread::mutex mutex;
+  };
+
+}
+
+#endif // OPENALPR_DETECTIONSCHEDULER_H
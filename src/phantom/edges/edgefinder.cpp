@@ -18,6 +18,7 @@
 */
 
 #include "edgefinder.h"
+#include "stats.h"
 #include "textlinecollection.h"
 #include "support/timing.h"
 
@@ -333,12 +334,7 @@ namespace alpr
     
     contrast = pow(contrast, 0.5f);
     
-    if (pipeline_data->config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "High Contrast Detection Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(pipeline_data->config, STAGE_HIGH_CONTRAST, startTime);
     
     return contrast > pipeline_data->config->contrastDetectionThreshold;
   }
@@ -18,6 +18,7 @@
 */
 
 #include "platecorners.h"
+#include "stats.h"
 
 using namespace cv;
 using namespace std;
@@ -121,12 +122,7 @@ namespace alpr
     corners.push_back(bestBottom.intersection(bestRight));
     corners.push_back(bestBottom.intersection(bestLeft));
 
-    if (pipelineData->config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "Plate Corners Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(pipelineData->config, STAGE_PLATE_CORNERS, startTime);
 
     return corners;
   }
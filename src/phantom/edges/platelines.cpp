@@ -18,6 +18,7 @@
 */
 
 #include "platelines.h"
+#include "stats.h"
 
 using namespace cv;
 using namespace std;
@@ -120,12 +121,7 @@ namespace alpr
       displayImage(pipelineData->config, "Hough Lines", dashboard);
     }
 
-    if (pipelineData->config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "Plate Lines Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(pipelineData->config, STAGE_PLATE_LINES, startTime);
 
   }
 
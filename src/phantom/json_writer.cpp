@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+
+#include "json_writer.h"
+
+namespace alpr
+{
+
+  static void appendInteger(std::string& buffer, int64_t number)
+  {
+    char digits[24];
+    int length = 0;
+
+    uint64_t magnitude = (number < 0) ? (uint64_t) 0 - (uint64_t) number : (uint64_t) number;
+    do
+    {
+      digits[length++] = '0' + (char) (magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (number < 0)
+      buffer.push_back('-');
+    while (length > 0)
+      buffer.push_back(digits[--length]);
+  }
+
+  // Equivalent to printf's "%f" for 1.0e-6 <= |number| <= 1.0e9.  Like printf, the value is rounded to 6 decimal
+  // places from its exact binary value, with ties going to the even digit.
+  static void appendFixed(std::string& buffer, double number)
+  {
+    if (number < 0)
+    {
+      buffer.push_back('-');
+      number = -number;
+    }
+
+    // number * 10^6 = mantissa * 5^6 / 2^shift, where the mantissa has 53 bits and shift is between 17 and 66.
+    int exponent;
+    uint64_t mantissa = (uint64_t) ldexp(frexp(number, &exponent), 53);
+    int shift = 47 - exponent;
+
+    // mantissa * 5^6 takes up to 68 bits, so it's kept as high * 2^32 + low.
+    uint64_t low = (mantissa & 0xffffffff) * 15625;
+    uint64_t high = (mantissa >> 32) * 15625 + (low >> 32);
+    low &= 0xffffffff;
+
+    uint64_t scaled;
+    if (shift >= 32)
+      scaled = high >> (shift - 32);
+    else
+      scaled = (high << (32 - shift)) | (low >> shift);
+
+    int half_bit = shift - 1;
+    bool half = (half_bit >= 32) ? ((high >> (half_bit - 32)) & 1) : ((low >> half_bit) & 1);
+    bool below_half;
+    if (half_bit > 32)
+      below_half = low != 0 || (high & ((((uint64_t) 1) << (half_bit - 32)) - 1)) != 0;
+    else
+      below_half = (low & ((((uint64_t) 1) << half_bit) - 1)) != 0;
+
+    if (half && (below_half || (scaled & 1)))
+      scaled++;
+
+    appendInteger(buffer, (int64_t) (scaled / 1000000));
+
+    char fraction[7];
+    uint64_t remainder = scaled % 1000000;
+    for (int i = 5; i >= 0; i--)
+    {
+      fraction[i] = '0' + (char) (remainder % 10);
+      remainder /= 10;
+    }
+    fraction[6] = '\0';
+
+    buffer.push_back('.');
+    buffer.append(fraction, 6);
+  }
+
+  // The formats that never come up for plate results (very large or very small fractions, infinity and NaN) are
+  // left to printf.  The decimal point is put back to '.' in case the locale uses something else.
+  static void appendPrintf(std::string& buffer, const char* format, double number)
+  {
+    char text[64];
+    int length = snprintf(text, sizeof(text), format, number);
+    if (length < 0)
+      return;
+    if (length >= (int) sizeof(text))
+      length = sizeof(text) - 1;
+
+    for (int i = 0; i < length; i++)
+    {
+      if (text[i] == ',')
+        text[i] = '.';
+    }
+    buffer.append(text, length);
+  }
+
+  JsonWriter::JsonWriter(std::string& buffer) : buffer(buffer)
+  {
+    needs_comma = false;
+  }
+
+  void JsonWriter::separate()
+  {
+    if (needs_comma)
+      buffer.push_back(',');
+    needs_comma = true;
+  }
+
+  void JsonWriter::beginObject()
+  {
+    separate();
+    buffer.push_back('{');
+    needs_comma = false;
+  }
+
+  void JsonWriter::endObject()
+  {
+    buffer.push_back('}');
+    needs_comma = true;
+  }
+
+  void JsonWriter::beginArray()
+  {
+    separate();
+    buffer.push_back('[');
+    needs_comma = false;
+  }
+
+  void JsonWriter::endArray()
+  {
+    buffer.push_back(']');
+    needs_comma = true;
+  }
+
+  void JsonWriter::key(const char* name)
+  {
+    separate();
+    appendString(buffer, name);
+    buffer.push_back(':');
+    needs_comma = false;
+  }
+
+  void JsonWriter::value(double number)
+  {
+    separate();
+    appendNumber(buffer, number);
+  }
+
+  void JsonWriter::value(const char* text)
+  {
+    separate();
+    appendString(buffer, text);
+  }
+
+  void JsonWriter::value(const std::string& text)
+  {
+    // cJSON only ever sees the C string, so anything after an embedded null character is left out the same way.
+    value(text.c_str());
+  }
+
+  void JsonWriter::value(const char* text, size_t length)
+  {
+    separate();
+    appendString(buffer, text, length);
+  }
+
+  void JsonWriter::boolean(bool value)
+  {
+    separate();
+    buffer.append(value ? "true" : "false");
+  }
+
+  void JsonWriter::appendNumber(std::string& buffer, double number)
+  {
+    // The same cases, in the same order, as print_number in cjson.c.
+    if (number <= INT_MAX && number >= INT_MIN && fabs(((double) (int) number) - number) <= DBL_EPSILON)
+      appendInteger(buffer, (int) number);
+    else if (fabs(floor(number) - number) <= DBL_EPSILON && fabs(number) < 1.0e60)
+    {
+      if (fabs(number) < 9.0e18)
+        appendInteger(buffer, (int64_t) number);
+      else
+        appendPrintf(buffer, "%.0f", number);
+    }
+    else if (fabs(number) < 1.0e-6 || fabs(number) > 1.0e9)
+      appendPrintf(buffer, "%e", number);
+    else if (number == number)
+      appendFixed(buffer, number);
+    else
+      appendPrintf(buffer, "%f", number);
+  }
+
+  void JsonWriter::appendString(std::string& buffer, const char* text)
+  {
+    appendString(buffer, text, strlen(text));
+  }
+
+  void JsonWriter::appendString(std::string& buffer, const char* text, size_t length)
+  {
+    static const char hex_digits[] = "0123456789abcdef";
+
+    // Like cJSON, the text ends at the first null character.
+    const char* end = text + length;
+    buffer.push_back('\"');
+    for (const char* ptr = text; ptr < end && *ptr; ptr++)
+    {
+      unsigned char token = (unsigned char) *ptr;
+      if (token > 31 && token != '\"' && token != '\\')
+      {
+        buffer.push_back(*ptr);
+        continue;
+      }
+
+      buffer.push_back('\\');
+      switch (token)
+      {
+        case '\\': buffer.push_back('\\'); break;
+        case '\"': buffer.push_back('\"'); break;
+        case '\b': buffer.push_back('b'); break;
+        case '\f': buffer.push_back('f'); break;
+        case '\n': buffer.push_back('n'); break;
+        case '\r': buffer.push_back('r'); break;
+        case '\t': buffer.push_back('t'); break;
+        default:
+          buffer.append("u00");
+          buffer.push_back(hex_digits[token >> 4]);
+          buffer.push_back(hex_digits[token & 15]);
+          break;
+      }
+    }
+    buffer.push_back('\"');
+  }
+
+}
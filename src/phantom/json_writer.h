@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_JSONWRITER_H
+#define OPENALPR_JSONWRITER_H
+
+#include <string>
+
+namespace alpr
+{
+
+  // Writes JSON directly to the end of a string, without building a tree of nodes first.
+  // The output is identical to cJSON_PrintUnformatted, including the way numbers are printed.
+  // Commas are added automatically, so values only need to be written in order.
+  class JsonWriter
+  {
+    public:
+      JsonWriter(std::string& buffer);
+
+      void beginObject();
+      void endObject();
+      void beginArray();
+      void endArray();
+
+      // Starts a member of the current object.  It must be followed by a value, object, or array.
+      void key(const char* name);
+
+      void value(double number);
+      void value(const char* text);
+      void value(const std::string& text);
+      void value(const char* text, size_t length);
+      void boolean(bool value);
+
+      void field(const char* name, double number) { key(name); value(number); }
+      void field(const char* name, const char* text) { key(name); value(text); }
+      void field(const char* name, const std::string& text) { key(name); value(text); }
+
+      // Appends a number formatted the same way as cJSON, without going through printf or the locale for ordinary values.
+      static void appendNumber(std::string& buffer, double number);
+      static void appendString(std::string& buffer, const char* text);
+      static void appendString(std::string& buffer, const char* text, size_t length);
+
+    private:
+      void separate();
+
+      std::string& buffer;
+      bool needs_comma;
+  };
+
+}
+
+#endif // OPENALPR_JSONWRITER_H
@@ -20,6 +20,7 @@
 #include <opencv2/core/core.hpp>
 
 #include "licenseplatecandidate.h"
+#include "stats.h"
 #include "edges/edgefinder.h"
 #include "transformation.h"
 
@@ -77,15 +78,36 @@ namespace alpr
 
 
     // Crop the plate corners from the original color image (after un-applying prewarp)
-    vector<Point2f> projectedPoints = pipeline_data->prewarp->projectPoints(pipeline_data->plate_corners, true);
+    vector<Point2f> projectedPoints = pipeline_data->prewarp->projectPoints(pipeline_data->plate_corners, pipeline_data->prewarp_transform, true);
     pipeline_data->color_deskewed = Mat::zeros(cropSize, pipeline_data->colorImg.type());
     std::vector<cv::Point2f> deskewed_points;
     deskewed_points.push_back(cv::Point2f(0,0));
     deskewed_points.push_back(cv::Point2f(pipeline_data->color_deskewed.cols,0));
     deskewed_points.push_back(cv::Point2f(pipeline_data->color_deskewed.cols,pipeline_data->color_deskewed.rows));
     deskewed_points.push_back(cv::Point2f(0,pipeline_data->color_deskewed.rows));
+
+    Mat colorSource;
+    if (pipeline_data->colorImg.isYuv())
+    {
+      // Only convert the area around the plate to color, rather than the whole frame.
+      Rect plateBounds = expandRect(boundingRect(projectedPoints), 2, 2, pipeline_data->grayImg.cols, pipeline_data->grayImg.rows);
+      colorSource = pipeline_data->colorImg.getRegion(plateBounds);
+      if (colorSource.empty())
+      {
+        pipeline_data->disqualified = true;
+        pipeline_data->disqualify_reason = "Plate corners are outside of the image";
+        return;
+      }
+      for (unsigned int i = 0; i < projectedPoints.size(); i++)
+        projectedPoints[i] -= Point2f(plateBounds.x, plateBounds.y);
+    }
+    else
+    {
+      colorSource = pipeline_data->colorImg.toMat();
+    }
+
     cv::Mat color_transmtx = cv::getPerspectiveTransform(projectedPoints, deskewed_points);
-    cv::warpPerspective(pipeline_data->colorImg, pipeline_data->color_deskewed, color_transmtx, pipeline_data->color_deskewed.size());
+    cv::warpPerspective(colorSource, pipeline_data->color_deskewed, color_transmtx, pipeline_data->color_deskewed.size());
 
     if (pipeline_data->color_deskewed.channels() > 2)
     {
@@ -127,12 +149,7 @@ namespace alpr
 
 
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "deskew Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_DESKEW, startTime);
 
 
 
@@ -18,6 +18,7 @@
 */
 
 #include "ocr.h"
+#include "stats.h"
 
 namespace alpr
 {
@@ -57,11 +58,6 @@ namespace alpr
     }
     
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      std::cout << "OCR Time: " << diffclock(startTime, endTime) << "ms." << std::endl;
-    }
+    recordStageTime(config, STAGE_OCR, startTime);
   }
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocrpool.h"
+#include "ocrfactory.h"
+
+namespace alpr
+{
+
+  OcrPool::OcrPool(Config* config)
+  {
+    this->config = config;
+
+    // Load the first engine up front, so that missing OCR data is reported while the library is loading.
+    checkin(checkout());
+  }
+
+  OcrPool::~OcrPool()
+  {
+    for (unsigned int i = 0; i < all_engines.size(); i++)
+      delete all_engines[i];
+  }
+
+  OCR* OcrPool::checkout()
+  {
+    {
+      tthread::lock_guard<tthread::mutex> guard(pool_mutex);
+      if (idle_engines.size() > 0)
+      {
+        OCR* ocr = idle_engines.back();
+        idle_engines.pop_back();
+        return ocr;
+      }
+    }
+
+    // Loading an engine is slow, so it's done outside of the lock.
+    OCR* ocr = createOcr(config);
+
+    tthread::lock_guard<tthread::mutex> guard(pool_mutex);
+    all_engines.push_back(ocr);
+    return ocr;
+  }
+
+  void OcrPool::checkin(OCR* ocr)
+  {
+    tthread::lock_guard<tthread::mutex> guard(pool_mutex);
+    idle_engines.push_back(ocr);
+  }
+
+  unsigned int OcrPool::size()
+  {
+    tthread::lock_guard<tthread::mutex> guard(pool_mutex);
+    return all_engines.size();
+  }
+
+}
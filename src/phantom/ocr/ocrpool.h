@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_OCRPOOL_H
+#define OPENALPR_OCRPOOL_H
+
+#include <vector>
+
+#include "config.h"
+#include "ocr.h"
+#include "support/tinythread.h"
+
+namespace alpr
+{
+
+  // Hands out OCR engines to concurrent recognition calls.  An OCR engine (and the post-processor
+  // that it carries) holds the state of a single plate while it is being read, so each call checks
+  // one out for its own exclusive use.  Engines are created on demand and reused afterwards, so the
+  // pool only grows to the number of calls that actually ran at the same time.
+  class OcrPool
+  {
+    public:
+      OcrPool(Config* config);
+      virtual ~OcrPool();
+
+      OCR* checkout();
+      void checkin(OCR* ocr);
+
+      // The number of engines that have been created so far.
+      unsigned int size();
+
+    private:
+      Config* config;
+
+      std::vector<OCR*> all_engines;
+      std::vector<OCR*> idle_engines;
+
+      tthread::mutex pool_mutex;
+  };
+
+  // Checks an OCR engine out of a pool for the lifetime of the lease.
+  class OcrLease
+  {
+    public:
+      OcrLease(OcrPool* pool) {
+        this->pool = pool;
+        this->ocr = pool->checkout();
+      }
+      virtual ~OcrLease() {
+        pool->checkin(ocr);
+      }
+
+      OCR* ocr;
+
+    private:
+      OcrPool* pool;
+
+      OcrLease(const OcrLease&);
+      OcrLease& operator=(const OcrLease&);
+  };
+
+}
+
+#endif // OPENALPR_OCRPOOL_H
@@ -20,6 +20,7 @@
 #include <opencv2/core/core.hpp>
 
 #include "charactersegmenter.h"
+#include "stats.h"
 
 using namespace cv;
 using namespace std;
@@ -133,12 +134,7 @@ namespace alpr
       }
 
 
-      if (config->debugTiming)
-      {
-        timespec endTime;
-        getTimeMonotonic(&endTime);
-        cout << "  -- Character Segmentation Create and Score Histograms Time: " << diffclock(startTime, endTime) << "ms." << endl;
-      }
+      recordStageTime(config, STAGE_SEGMENTATION_HISTOGRAMS, startTime);
 
       vector<Rect> candidateBoxes = getBestCharBoxes(pipeline_data->thresholds[0], lineBoxes, avgCharWidth);
 
@@ -172,12 +168,7 @@ namespace alpr
       for (unsigned int cboxidx = 0; cboxidx < candidateBoxes.size(); cboxidx++)
         pipeline_data->charRegionsFlat.push_back(candidateBoxes[cboxidx]);
 
-      if (config->debugTiming)
-      {
-        timespec endTime;
-        getTimeMonotonic(&endTime);
-        cout << "  -- Character Segmentation Box cleaning/filtering Time: " << diffclock(startTime, endTime) << "ms." << endl;
-      }
+      recordStageTime(config, STAGE_SEGMENTATION_CLEANUP, startTime);
 
       if (this->config->debugCharSegmenter)
       {
@@ -206,12 +197,7 @@ namespace alpr
     }
     cleanCharRegions(pipeline_data->thresholds, all_regions_combined);
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "Character Segmenter Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_SEGMENTATION, startTime);
   }
 
   
@@ -22,7 +22,7 @@ namespace alpr
     this->init(colorImage, grayImage, regionOfInterest, config);
   }
   
-  PipelineData::PipelineData(Mat colorImage, Mat grayImg, Rect regionOfInterest, Config* config)
+  PipelineData::PipelineData(ColorImage colorImage, Mat grayImg, Rect regionOfInterest, Config* config)
   {
     this->init(colorImage, grayImg, regionOfInterest, config);
   }
@@ -41,7 +41,7 @@ namespace alpr
     thresholds.clear();
   }
 
-  void PipelineData::init(cv::Mat colorImage, cv::Mat grayImage, cv::Rect regionOfInterest, Config *config) {
+  void PipelineData::init(ColorImage colorImage, cv::Mat grayImage, cv::Rect regionOfInterest, Config *config) {
     this->colorImg = colorImage;
     this->grayImg = grayImage;
     this->regionOfInterest = regionOfInterest;
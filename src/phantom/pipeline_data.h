@@ -8,6 +8,7 @@
 #include "textdetection/textline.h"
 #include "edges/scorekeeper.h"
 #include "prewarp.h"
+#include "colorimage.h"
 
 namespace alpr
 {
@@ -17,18 +18,19 @@ namespace alpr
 
     public:
       PipelineData(cv::Mat colorImage, cv::Rect regionOfInterest, Config* config);
-      PipelineData(cv::Mat colorImage, cv::Mat grayImage, cv::Rect regionOfInterest, Config* config);
+      PipelineData(ColorImage colorImage, cv::Mat grayImage, cv::Rect regionOfInterest, Config* config);
       virtual ~PipelineData();
 
-      void init(cv::Mat colorImage, cv::Mat grayImage, cv::Rect regionOfInterest, Config* config);
+      void init(ColorImage colorImage, cv::Mat grayImage, cv::Rect regionOfInterest, Config* config);
       void clearThresholds();
 
       // Inputs
       Config* config;
 
       PreWarp* prewarp;
+      cv::Mat prewarp_transform; // The prewarp transform for this image.  Empty without a prewarp.
 
-      cv::Mat colorImg;
+      ColorImage colorImg;
       cv::Mat grayImg;
       cv::Rect regionOfInterest;
 
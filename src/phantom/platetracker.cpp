@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platetracker.h"
+
+#include <algorithm>
+#include <map>
+
+#include "alpr_impl.h"
+
+using namespace std;
+using namespace cv;
+
+namespace alpr {
+
+    // The state of a plate being followed from frame to frame.
+    struct PlateTrack {
+        int64_t id;
+
+        cv::Rect box; // Where the plate was detected most recently.
+        cv::Rect read_box; // Where the plate was detected when it was last read.
+        AlprPlateResult read; // The most recent read, positioned at read_box.
+        bool has_read;
+        int agreeing_reads; // The number of reads in a row that returned the same plate number.
+        int frames_since_read;
+        int missed; // The number of frames in a row the plate wasn't detected in.
+
+        int frames_seen;
+        int ocr_runs;
+        int64_t first_frame;
+        int64_t last_frame;
+        int64_t first_epoch_time;
+        int64_t last_epoch_time;
+
+        map<string, float> votes; // The summed confidence of every plate number read for this track.
+        map<string, AlprPlateResult> best_reads; // The most confident read of every plate number.
+    };
+
+    static float intersectionOverUnion(cv::Rect a, cv::Rect b) {
+        float intersection = (a & b).area();
+        float combined = a.area() + b.area() - intersection;
+        if (combined <= 0) {
+            return 0;
+        }
+        return intersection / combined;
+    }
+
+    static cv::Rect plateBoundingBox(const AlprPlateResult& plate) {
+        int min_x = plate.plate_points[0].x, max_x = plate.plate_points[0].x;
+        int min_y = plate.plate_points[0].y, max_y = plate.plate_points[0].y;
+        for (int i = 1; i < 4; i++) {
+            min_x = std::min(min_x, plate.plate_points[i].x);
+            max_x = std::max(max_x, plate.plate_points[i].x);
+            min_y = std::min(min_y, plate.plate_points[i].y);
+            max_y = std::max(max_y, plate.plate_points[i].y);
+        }
+        return cv::Rect(min_x, min_y, max_x - min_x, max_y - min_y);
+    }
+
+    // Moves a read to a new position, along with the corners of each of its characters.
+    static AlprPlateResult shiftPlate(AlprPlateResult plate, int dx, int dy) {
+        for (int i = 0; i < 4; i++) {
+            plate.plate_points[i].x += dx;
+            plate.plate_points[i].y += dy;
+        }
+        for (unsigned int c = 0; c < plate.bestPlate.character_details.size(); c++) {
+            for (int i = 0; i < 4; i++) {
+                plate.bestPlate.character_details[c].corners[i].x += dx;
+                plate.bestPlate.character_details[c].corners[i].y += dy;
+            }
+        }
+        return plate;
+    }
+
+    struct TrackMatch {
+        float iou;
+        int detection;
+        int track;
+    };
+
+    static bool matchBefore(const TrackMatch& a, const TrackMatch& b) {
+        return a.iou > b.iou;
+    }
+
+    PlateTracker::PlateTracker() {
+        iou_threshold = 0.3;
+        min_confidence = 80;
+        confirm_frames = 3;
+        max_missed_frames = 5;
+        recheck_interval = 30;
+
+        frame_number = -1;
+        next_track_id = 0;
+        ocr_skipped = 0;
+    }
+
+    PlateTracker::~PlateTracker() {
+        for (unsigned int i = 0; i < tracks.size(); i++) {
+            delete tracks[i];
+        }
+    }
+
+    void PlateTracker::setIouThreshold(float iou_threshold) {
+        this->iou_threshold = iou_threshold;
+    }
+
+    void PlateTracker::setMinConfidence(float min_confidence) {
+        this->min_confidence = min_confidence;
+    }
+
+    void PlateTracker::setConfirmFrames(int confirm_frames) {
+        this->confirm_frames = confirm_frames;
+    }
+
+    void PlateTracker::setMaxMissedFrames(int max_missed_frames) {
+        this->max_missed_frames = max_missed_frames;
+    }
+
+    void PlateTracker::setRecheckInterval(int recheck_interval) {
+        this->recheck_interval = recheck_interval;
+    }
+
+    AlprResults PlateTracker::recognize(Alpr* alpr, unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest) {
+        timespec startTime;
+        getTimeMonotonic(&startTime);
+
+        frame_number++;
+        int64_t epoch_time = getEpochTimeMs();
+
+        // Find the plates in this frame, ignoring duplicates found by more than one country.
+        std::vector<AlprRegionOfInterest> detected = alpr->detectPlates(pixelData, bytesPerPixel, imgWidth, imgHeight, regionsOfInterest);
+        vector<cv::Rect> boxes;
+        for (unsigned int i = 0; i < detected.size(); i++) {
+            cv::Rect box(detected[i].x, detected[i].y, detected[i].width, detected[i].height);
+            bool duplicate = false;
+            for (unsigned int j = 0; j < boxes.size() && !duplicate; j++) {
+                duplicate = intersectionOverUnion(box, boxes[j]) > 0.5;
+            }
+            if (!duplicate) {
+                boxes.push_back(box);
+            }
+        }
+
+        // Continue existing tracks with the detections that overlap them the most.
+        vector<TrackMatch> candidates;
+        for (unsigned int d = 0; d < boxes.size(); d++) {
+            for (unsigned int t = 0; t < tracks.size(); t++) {
+                float iou = intersectionOverUnion(boxes[d], tracks[t]->box);
+                if (iou >= iou_threshold) {
+                    TrackMatch match;
+                    match.iou = iou;
+                    match.detection = d;
+                    match.track = t;
+                    candidates.push_back(match);
+                }
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), matchBefore);
+
+        vector<int> detection_track(boxes.size(), -1);
+        vector<bool> track_matched(tracks.size(), false);
+        for (unsigned int i = 0; i < candidates.size(); i++) {
+            if (detection_track[candidates[i].detection] < 0 && !track_matched[candidates[i].track]) {
+                detection_track[candidates[i].detection] = candidates[i].track;
+                track_matched[candidates[i].track] = true;
+            }
+        }
+
+        // Plates on stable tracks reuse their earlier read.  Everything else is read again.
+        AlprResults results;
+        vector<int> read_detections;
+        vector<cv::Rect> read_areas;
+        for (unsigned int d = 0; d < boxes.size(); d++) {
+            int t = detection_track[d];
+            bool stable = false;
+            if (t >= 0 && tracks[t]->has_read) {
+                PlateTrack* track = tracks[t];
+                float size_ratio = (float) boxes[d].area() / std::max(track->read_box.area(), 1);
+                stable = track->agreeing_reads >= confirm_frames &&
+                         track->read.bestPlate.overall_confidence >= min_confidence &&
+                         track->frames_since_read < recheck_interval &&
+                         size_ratio > 0.66 && size_ratio < 1.5;
+            }
+
+            if (stable) {
+                PlateTrack* track = tracks[t];
+                results.plates.push_back(shiftPlate(track->read, boxes[d].x - track->read_box.x, boxes[d].y - track->read_box.y));
+                results.plates.back().processing_time_ms = 0;
+                track->box = boxes[d];
+                track->frames_since_read++;
+                ocr_skipped++;
+            } else {
+                // Leave some margin around the plate, so the detector can still find it inside the region.
+                read_detections.push_back(d);
+                read_areas.push_back(expandRect(boxes[d], boxes[d].width / 4, boxes[d].height / 4, imgWidth, imgHeight));
+            }
+        }
+
+        // Each region is searched separately, so a plate inside two overlapping regions would be read twice.
+        read_areas = mergeOverlappingRects(read_areas);
+        std::vector<AlprRegionOfInterest> read_regions;
+        for (unsigned int i = 0; i < read_areas.size(); i++) {
+            read_regions.push_back(AlprRegionOfInterest(read_areas[i].x, read_areas[i].y, read_areas[i].width, read_areas[i].height));
+        }
+
+        vector<AlprPlateResult> fresh_plates;
+        if (read_regions.size() > 0) {
+            AlprResults read_results = alpr->recognize(pixelData, bytesPerPixel, imgWidth, imgHeight, read_regions);
+            fresh_plates = read_results.plates;
+            epoch_time = read_results.epoch_time;
+            results.truncated = read_results.truncated;
+            results.truncated_reason = read_results.truncated_reason;
+        }
+
+        // Match each new read with the detection it came from.
+        vector<int> detection_plate(boxes.size(), -1);
+        vector<bool> plate_used(fresh_plates.size(), false);
+        for (unsigned int r = 0; r < read_detections.size(); r++) {
+            int d = read_detections[r];
+            float best_iou = 0;
+            for (unsigned int p = 0; p < fresh_plates.size(); p++) {
+                float iou = intersectionOverUnion(boxes[d], plateBoundingBox(fresh_plates[p]));
+                if (!plate_used[p] && iou > best_iou) {
+                    best_iou = iou;
+                    detection_plate[d] = p;
+                }
+            }
+            if (detection_plate[d] >= 0) {
+                plate_used[detection_plate[d]] = true;
+            }
+        }
+
+        for (unsigned int r = 0; r < read_detections.size(); r++) {
+            int d = read_detections[r];
+            if (detection_track[d] < 0) { // Start a new track for a plate that wasn't seen before.
+                PlateTrack* track = new PlateTrack();
+                track->id = next_track_id++;
+                track->has_read = false;
+                track->agreeing_reads = 0;
+                track->frames_since_read = 0;
+                track->missed = 0;
+                track->frames_seen = 0;
+                track->ocr_runs = 0;
+                track->first_frame = frame_number;
+                track->first_epoch_time = epoch_time;
+                detection_track[d] = tracks.size();
+                tracks.push_back(track);
+                track_matched.push_back(true);
+            }
+
+            PlateTrack* track = tracks[detection_track[d]];
+            track->box = boxes[d];
+
+            if (detection_plate[d] < 0) { // The plate couldn't be read in this frame, so it needs to be read again next time.
+                track->agreeing_reads = 0;
+                track->frames_since_read++;
+                continue;
+            }
+
+            const AlprPlateResult& plate = fresh_plates[detection_plate[d]];
+            const string& characters = plate.bestPlate.characters;
+            if (track->has_read && track->read.bestPlate.characters == characters) {
+                track->agreeing_reads++;
+            } else {
+                track->agreeing_reads = 1;
+            }
+            track->read = plate;
+            track->read_box = boxes[d];
+            track->has_read = true;
+            track->frames_since_read = 0;
+            track->ocr_runs++;
+
+            track->votes[characters] += plate.bestPlate.overall_confidence;
+            if (track->best_reads.count(characters) == 0 || track->best_reads[characters].bestPlate.overall_confidence < plate.bestPlate.overall_confidence) {
+                track->best_reads[characters] = plate;
+            }
+        }
+
+        for (unsigned int p = 0; p < fresh_plates.size(); p++) {
+            results.plates.push_back(fresh_plates[p]);
+        }
+
+        // Update every track, and end the ones that haven't been seen for too long.
+        vector<PlateTrack*> open_tracks;
+        for (unsigned int t = 0; t < tracks.size(); t++) {
+            PlateTrack* track = tracks[t];
+            if (track_matched[t]) {
+                track->missed = 0;
+                track->frames_seen++;
+                track->last_frame = frame_number;
+                track->last_epoch_time = epoch_time;
+                open_tracks.push_back(track);
+            } else if (++track->missed > max_missed_frames) {
+                endTrack(track);
+            } else {
+                open_tracks.push_back(track);
+            }
+        }
+        tracks = open_tracks;
+
+        for (unsigned int i = 0; i < results.plates.size(); i++) {
+            results.plates[i].plate_index = i;
+        }
+
+        timespec endTime;
+        getTimeMonotonic(&endTime);
+
+        results.epoch_time = epoch_time;
+        results.img_width = imgWidth;
+        results.img_height = imgHeight;
+        results.total_processing_time_ms = diffclock(startTime, endTime);
+        results.regionsOfInterest = regionsOfInterest;
+        if (results.regionsOfInterest.size() == 0) {
+            results.regionsOfInterest.push_back(AlprRegionOfInterest(0, 0, imgWidth, imgHeight));
+        }
+        return results;
+    }
+
+    void PlateTracker::endAllTracks() {
+        for (unsigned int i = 0; i < tracks.size(); i++) {
+            endTrack(tracks[i]);
+        }
+        tracks.clear();
+    }
+
+    std::vector<AlprTrack> PlateTracker::finishedTracks() {
+        std::vector<AlprTrack> tracks_out;
+        tracks_out.swap(finished);
+        return tracks_out;
+    }
+
+    int64_t PlateTracker::ocrSkipped() {
+        return ocr_skipped;
+    }
+
+    // Consolidates a track into a single result, then frees it.  Tracks that were never read are dropped.
+    void PlateTracker::endTrack(PlateTrack* track) {
+        if (track->has_read) {
+            string best_characters;
+            float best_votes = -1;
+            for (map<string, float>::iterator it = track->votes.begin(); it != track->votes.end(); it++) {
+                if (it->second > best_votes) {
+                    best_votes = it->second;
+                    best_characters = it->first;
+                }
+            }
+
+            AlprTrack result;
+            result.track_id = track->id;
+            result.first_frame = track->first_frame;
+            result.last_frame = track->last_frame;
+            result.first_epoch_time = track->first_epoch_time;
+            result.last_epoch_time = track->last_epoch_time;
+            result.frames_seen = track->frames_seen;
+            result.ocr_runs = track->ocr_runs;
+            result.plate = track->best_reads[best_characters];
+            result.plate.plate_index = 0;
+            finished.push_back(result);
+        }
+
+        delete track;
+    }
+
+    std::string PlateTracker::toJson(const AlprTrack track) {
+        string response;
+        JsonWriter writer(response);
+        writer.beginObject();
+
+        writer.field("version", 2);
+        writer.field("data_type", "alpr_track");
+        writer.field("track_id", track.track_id);
+        if (track.stream_id >= 0) {
+            writer.field("stream_id", track.stream_id);
+        }
+        writer.field("first_frame", track.first_frame);
+        writer.field("last_frame", track.last_frame);
+        writer.field("first_epoch_time", track.first_epoch_time);
+        writer.field("last_epoch_time", track.last_epoch_time);
+        writer.field("frames_seen", track.frames_seen);
+        writer.field("ocr_runs", track.ocr_runs);
+        writer.key("plate");
+        AlprImpl::writeJson(writer, track.plate);
+
+        writer.endObject();
+        return response;
+    }
+
+}
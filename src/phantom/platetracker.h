@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_PLATETRACKER_H
+#define OPENALPR_PLATETRACKER_H
+
+#include <string>
+#include <stdint.h>
+#include <vector>
+
+#include "alpr.h"
+
+namespace alpr {
+
+    // The consolidated result for a plate that was followed across several frames.
+    class AlprTrack {
+        public:
+            AlprTrack() {
+                stream_id = -1;
+            };
+            virtual ~AlprTrack() {};
+
+            int64_t track_id;
+            int stream_id; // Copied from the results the track was built from.  -1 when not applicable.
+
+            int64_t first_frame;
+            int64_t last_frame;
+            int64_t first_epoch_time;
+            int64_t last_epoch_time;
+
+            int frames_seen; // The number of frames the plate was detected in.
+            int ocr_runs; // The number of frames the plate was actually read in.  The other frames reused an earlier read.
+
+            // The most common read over the whole track, with the plate position from its most confident read.
+            AlprPlateResult plate;
+    };
+
+    struct PlateTrack;
+
+    // Follows plates from one frame to the next, and only reads them again when something changes.  Every frame is
+    // still searched for plates, but a plate that matches a track which has been read the same way several times with
+    // high confidence reuses the earlier read instead of going through segmentation and OCR again.  When a track ends,
+    // a single consolidated result is available from finishedTracks().
+    //
+    // A tracker holds the state of a single video source, and frames must be passed in order.  It doesn't own the
+    // Phantom instance, so any loaded instance can be used for each frame.
+    class OPENALPR_DLL_EXPORT PlateTracker {
+        public:
+            PlateTracker();
+            virtual ~PlateTracker();
+
+            // The minimum overlap (intersection over union) for a detected plate to continue a track.  Default=0.3
+            void setIouThreshold(float iou_threshold);
+            // The minimum confidence for a read to be reused.  Default=80
+            void setMinConfidence(float min_confidence);
+            // The number of matching reads in a row before a track is considered stable.  Default=3
+            void setConfirmFrames(int confirm_frames);
+            // The number of frames a track can go undetected before it ends.  Default=5
+            void setMaxMissedFrames(int max_missed_frames);
+            // Stable plates are still read again after this many frames, to catch a drop in confidence.  Default=30
+            void setRecheckInterval(int recheck_interval);
+
+            // Recognizes plates in the next frame of the source.  The results contain every plate in the frame,
+            // whether it was read in this frame or reused from its track.
+            AlprResults recognize(Alpr* alpr, unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest);
+
+            // Ends every open track, for example at the end of a video.
+            void endAllTracks();
+
+            // Returns the tracks that have ended since the last call.
+            std::vector<AlprTrack> finishedTracks();
+
+            // The number of plate reads that were skipped by reusing an earlier read.
+            int64_t ocrSkipped();
+
+            static std::string toJson(const AlprTrack track);
+
+        private:
+            void endTrack(PlateTrack* track);
+
+            std::vector<PlateTrack*> tracks;
+            std::vector<AlprTrack> finished;
+
+            float iou_threshold;
+            float min_confidence;
+            int confirm_frames;
+            int max_missed_frames;
+            int recheck_interval;
+
+            int64_t frame_number;
+            int64_t next_track_id;
+            int64_t ocr_skipped;
+    };
+
+}
+
+#endif // OPENALPR_PLATETRACKER_H
@@ -18,6 +18,7 @@
 */
 
 #include "postprocess.h"
+#include "stats.h"
 
 #include <fstream>
 #include <queue>
@@ -200,12 +201,7 @@ namespace alpr
 
     findAllPermutations(templateregion, topn);
 
-    if (config->debugTiming)
-    {
-      timespec permutationEndTime;
-      getTimeMonotonic(&permutationEndTime);
-      cout << " -- PostProcess Permutation Time: " << diffclock(permutationStartTime, permutationEndTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_POSTPROCESS_PERMUTATIONS, permutationStartTime);
 
     if (allPossibilities.size() > 0)
     {
@@ -243,12 +239,7 @@ namespace alpr
       cout << allPossibilities.size() << " total permutations" << endl;
     }
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "PostProcess Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_POSTPROCESS, startTime);
 
     if (this->config->debugPostProcess)
       cout << "PostProcess Analysis Complete: " << bestChars << " -- MATCH: " << matchesTemplate << endl;
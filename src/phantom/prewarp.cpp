@@ -28,6 +28,7 @@ namespace alpr
   PreWarp::PreWarp(Config* config)
   {
     this->config = config;
+    this->version = 0;
     initialize(config->prewarp);
   }
   
@@ -47,6 +48,7 @@ namespace alpr
         cout << "{\"error\": \"No prewarp configuration specified.\"}" << endl;
 
       this->valid = false;
+      this->version++;
     }
     else if (commacount != 9)
     {
@@ -54,6 +56,7 @@ namespace alpr
         cout << "{\"error\": \"Invalid prewarp configuration.\"}" << endl;
 
       this->valid = false;
+      this->version++;
     }
     else
     {
@@ -67,6 +70,7 @@ namespace alpr
       if (name != "planar")
       {
         this->valid = false;
+        this->version++;
       }
       else
       {
@@ -99,10 +103,11 @@ namespace alpr
     timespec endTime;
     getTimeMonotonic(&endTime);
     if (config->debugTiming)
-      cout << "Prewarp Initialization Time: " << diffclock(startTime, endTime) << "ms." << endl;
+      cerr << "Prewarp Initialization Time: " << diffclock(startTime, endTime) << "ms." << endl;
   }
   void PreWarp::clear() {
     this->valid = false;
+    this->version++;
   }
 
   PreWarp::~PreWarp() {
@@ -133,28 +138,35 @@ namespace alpr
     this->dist = dist;
     
     this->valid = true;
+    this->version++;
   }
   
-  cv::Mat PreWarp::warpImage(Mat image) {
+  cv::Mat PreWarp::getTransform(cv::Size image_size) {
     if (!this->valid)
-    {
-      if (this->config->debugPrewarp)
-        cout << "prewarp skipped due to missing prewarp config" << endl;
-      return image;
-    }
+      return Mat();
     
-      
-    float width_ratio = w / ((float)image.cols);
-    float height_ratio = h / ((float)image.rows);
+    float width_ratio = w / ((float)image_size.width);
+    float height_ratio = h / ((float)image_size.height);
 
     float rx = rotationx * width_ratio;
     float ry = rotationy * width_ratio;
     float px = panX / width_ratio;
     float py = panY / height_ratio;
 
-
-    transform = getTransform(image.cols, image.rows, rx, ry, rotationz, px, py, stretchX, dist);
-    
+    return getTransform(image_size.width, image_size.height, rx, ry, rotationz, px, py, stretchX, dist);
+  }
+  
+  cv::Mat PreWarp::warpImage(Mat image) {
+    return warpImage(image, getTransform(image.size()));
+  }
+  
+  cv::Mat PreWarp::warpImage(Mat image, const Mat& transform) {
+    if (transform.empty())
+    {
+      if (this->config->debugPrewarp)
+        cout << "prewarp skipped due to missing prewarp config" << endl;
+      return image;
+    }
     
     Mat warped_image;
   
@@ -171,30 +183,30 @@ namespace alpr
   // Projects a "region of interest" into the new space
   // The rect needs to be converted to points, warped, then converted back into a 
   // bounding rectangle
-  vector<Rect> PreWarp::projectRects(vector<Rect> rects, int maxWidth, int maxHeight, bool inverse) {
+  vector<Rect> PreWarp::projectRects(vector<Rect> rects, const Mat& transform, int maxWidth, int maxHeight, bool inverse) {
     
-    if (!this->valid)
+    if (transform.empty())
       return rects;
     
     vector<Rect> projected_rects;
     
     for (unsigned int i = 0; i < rects.size(); i++)
     {
-      Rect r = projectRect(rects[i], maxWidth, maxHeight, inverse);
+      Rect r = projectRect(rects[i], transform, maxWidth, maxHeight, inverse);
       projected_rects.push_back(r);
     }
     
     return projected_rects;
   }
   
-  Rect PreWarp::projectRect(Rect rect, int maxWidth, int maxHeight, bool inverse) {
+  Rect PreWarp::projectRect(Rect rect, const Mat& transform, int maxWidth, int maxHeight, bool inverse) {
       vector<Point2f> points;
       points.push_back(Point(rect.x, rect.y));
       points.push_back(Point(rect.x + rect.width, rect.y));
       points.push_back(Point(rect.x + rect.width, rect.y + rect.height));
       points.push_back(Point(rect.x, rect.y + rect.height));
       
-      vector<Point2f> projectedPoints = projectPoints(points, inverse);
+      vector<Point2f> projectedPoints = projectPoints(points, transform, inverse);
       
       Rect projectedRect = boundingRect(projectedPoints);
       projectedRect = expandRect(projectedRect, 0, 0, maxWidth, maxHeight);
@@ -202,9 +214,9 @@ namespace alpr
       return projectedRect;
   }
 
-  vector<Point2f> PreWarp::projectPoints(vector<Point2f> points, bool inverse) {
+  vector<Point2f> PreWarp::projectPoints(vector<Point2f> points, const Mat& transform, bool inverse) {
     
-    if (!this->valid)
+    if (transform.empty())
       return points;
     
     vector<Point2f> output;
@@ -218,23 +230,19 @@ namespace alpr
   }
   
 
-  void PreWarp::projectPlateRegions(vector<PlateRegion>& plateRegions, int maxWidth, int maxHeight, bool inverse){
+  void PreWarp::projectPlateRegions(PlateRegions& plateRegions, const Mat& transform, int maxWidth, int maxHeight, bool inverse){
     
-    if (!this->valid)
+    if (transform.empty())
       return;
     
-    for (unsigned int i = 0; i < plateRegions.size(); i++)
-    {
-      vector<Rect> singleRect;
-      singleRect.push_back(plateRegions[i].rect);
-      vector<Rect> transformedRect = projectRects(singleRect, maxWidth, maxHeight, inverse);
-      plateRegions[i].rect.x = transformedRect[0].x;
-      plateRegions[i].rect.y = transformedRect[0].y;
-      plateRegions[i].rect.width = transformedRect[0].width;
-      plateRegions[i].rect.height = transformedRect[0].height;
-      
-      projectPlateRegions(plateRegions[i].children, maxWidth, maxHeight, inverse);
-    }
+    // The children are in the same list, so every region is projected in a single pass.
+    vector<Rect> rects(plateRegions.regions.size());
+    for (unsigned int i = 0; i < plateRegions.regions.size(); i++)
+      rects[i] = plateRegions.regions[i].rect;
+    
+    vector<Rect> transformedRects = projectRects(rects, transform, maxWidth, maxHeight, inverse);
+    for (unsigned int i = 0; i < plateRegions.regions.size(); i++)
+      plateRegions.regions[i].rect = transformedRects[i];
   }
   
   cv::Mat PreWarp::getTransform(float w, float h, 
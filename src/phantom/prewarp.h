@@ -34,21 +34,29 @@ namespace alpr
     void initialize(std::string prewarp_config);
     void clear();
     
+    // The prewarp is shared by every thread that recognizes an image, so nothing below changes it.  The transform
+    // depends on the size of the image, so each image computes its own and passes it along.  The transform is empty
+    // when there is no prewarp, and the functions below leave their input alone.
+    cv::Mat getTransform(cv::Size image_size);
+
     cv::Mat warpImage(cv::Mat image);
-    std::vector<cv::Point2f> projectPoints(std::vector<cv::Point2f> points, bool inverse);
-    std::vector<cv::Rect> projectRects(std::vector<cv::Rect> rects, int maxWidth, int maxHeight, bool inverse);
-    cv::Rect projectRect(cv::Rect rect, int maxWidth, int maxHeight, bool inverse);
-    void projectPlateRegions(std::vector<PlateRegion>& plateRegions, int maxWidth, int maxHeight, bool inverse);
+    cv::Mat warpImage(cv::Mat image, const cv::Mat& transform);
+    std::vector<cv::Point2f> projectPoints(std::vector<cv::Point2f> points, const cv::Mat& transform, bool inverse);
+    std::vector<cv::Rect> projectRects(std::vector<cv::Rect> rects, const cv::Mat& transform, int maxWidth, int maxHeight, bool inverse);
+    cv::Rect projectRect(cv::Rect rect, const cv::Mat& transform, int maxWidth, int maxHeight, bool inverse);
+    void projectPlateRegions(PlateRegions& plateRegions, const cv::Mat& transform, int maxWidth, int maxHeight, bool inverse);
 
     void setTransform(float w, float h, float rotationx, float rotationy, float rotationz, float panX, float panY, float stretchX, float dist);
     
     bool valid;
     
+    // Changes whenever the transform does, so anything built from the transform can tell when it is out of date.
+    unsigned int version;
+    
     std::string toString();
     
   private:
     Config* config;
-    cv::Mat transform;
     
     cv::Mat getTransform(float w, float h, float rotationx, float rotationy, float rotationz, float panX, float panY, float stretchX, float dist);
     
@@ -26,14 +26,12 @@ namespace alpr
 
   ResultAggregator::ResultAggregator(ResultMergeStrategy merge_strategy, int topn, Config* config)
   {
-    this->prewarp = new PreWarp(config);
     this->merge_strategy = merge_strategy;
     this->topn = topn;
     this->config = config;
   }
 
   ResultAggregator::~ResultAggregator() {
-    delete prewarp;
   }
 
 
@@ -71,10 +69,12 @@ namespace alpr
     
     //cout << "Iteration: " << index << ": " << x_rotation << ", " << y_rotation << ", " << z_rotation << endl;
     
-    prewarp->setTransform(WIDTH_HEIGHT, WIDTH_HEIGHT, x_rotation, y_rotation, z_rotation, 
+    // Each call uses its own transform, so that several passes can be prepared at the same time.
+    PreWarp prewarp(config);
+    prewarp.setTransform(WIDTH_HEIGHT, WIDTH_HEIGHT, x_rotation, y_rotation, z_rotation, 
             NO_PAN_VAL, NO_PAN_VAL, NO_MOVE_WIDTH_DIST, NO_MOVE_WIDTH_DIST);
     
-    return prewarp->warpImage(image);
+    return prewarp.warpImage(image);
   }
 
   bool compareScore(const std::pair<float, ResultPlateScore>& firstElem, const std::pair<float, ResultPlateScore>& secondElem) {
@@ -94,10 +94,7 @@ namespace alpr
     // Plate regions are needed for benchmarking
     // Copy all detected boxes across all results
     for (unsigned int i = 0; i < all_results.size(); i++)
-    {
-      for (unsigned int k = 0; k < all_results[i].plateRegions.size(); k++)
-        response.plateRegions.push_back(all_results[i].plateRegions[k]);
-    }
+      response.plateRegions.append(all_results[i].plateRegions);
 
 
     response.results.epoch_time = all_results[0].results.epoch_time;
@@ -70,7 +70,6 @@ namespace alpr
   private:
     
     int topn;
-    PreWarp* prewarp;
     Config* config;
     
     std::vector<AlprFullDetails> all_results;
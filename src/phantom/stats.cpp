@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <iostream>
+#include <map>
+#include <algorithm>
+
+#include "stats.h"
+#include "json_writer.h"
+#include "support/tinythread.h"
+
+namespace alpr
+{
+
+  // Threads are spread over a fixed number of shards, so the memory used doesn't grow as threads come and go.
+  const int STATS_SHARDS = 32;
+
+  // Bucket 0 holds anything under a microsecond.  After that, each power of two from 1us up to about 4.5 minutes is
+  // split into 4 buckets, so a bucket's midpoint is never more than 12.5% away from the times in it.
+  const int SUB_BUCKETS = 4;
+  const int HISTOGRAM_BUCKETS = 1 + (28 * SUB_BUCKETS);
+
+  struct StageInfo
+  {
+    const char* name;
+    const char* label; // Printed with debug_timing.
+  };
+
+  static const StageInfo stage_info[STAGE_COUNT] = {
+    { "image", "Total Time to process image" },
+    { "detection", "LBP Time" },
+    { "plate", "Plate Candidate Time" },
+    { "thresholds", "  -- Produce Threshold Time" },
+    { "character_analysis", "Character Analysis Time" },
+    { "character_contours", "  -- Character Analysis Find Contours Time" },
+    { "character_filter", "  -- Character Analysis Filter Time" },
+    { "color_filter", "  -- ColorFilter Time" },
+    { "plate_lines", "Plate Lines Time" },
+    { "plate_corners", "Plate Corners Time" },
+    { "high_contrast", "High Contrast Detection Time" },
+    { "deskew", "deskew Time" },
+    { "ocr", "OCR Time" },
+    { "segmentation", "Character Segmenter Time" },
+    { "segmentation_histograms", "  -- Character Segmentation Create and Score Histograms Time" },
+    { "segmentation_cleanup", "  -- Character Segmentation Box cleaning/filtering Time" },
+    { "postprocess", "PostProcess Time" },
+    { "postprocess_permutations", " -- PostProcess Permutation Time" },
+    { "result_generation", "Result Generation Time" }
+  };
+
+  struct StageHistogram
+  {
+    int64_t count;
+    double total_ms;
+    double max_ms;
+    int64_t buckets[HISTOGRAM_BUCKETS];
+  };
+
+  struct StatsShard
+  {
+    StatsShard() { clear(); }
+
+    void clear()
+    {
+      for (int i = 0; i < STAGE_COUNT; i++)
+      {
+        stages[i].count = 0;
+        stages[i].total_ms = 0;
+        stages[i].max_ms = 0;
+        std::fill(stages[i].buckets, stages[i].buckets + HISTOGRAM_BUCKETS, 0);
+      }
+      std::fill(counters, counters + COUNTER_COUNT, 0);
+      disqualified.clear();
+    }
+
+    tthread::mutex mutex;
+    StageHistogram stages[STAGE_COUNT];
+    int64_t counters[COUNTER_COUNT];
+    std::map<std::string, int64_t> disqualified;
+  };
+
+  struct StatsCollector
+  {
+    StatsCollector()
+    {
+      getTimeMonotonic(&startTime);
+      next_shard = 0;
+    }
+
+    StatsShard shards[STATS_SHARDS];
+    tthread::mutex mutex; // Guards startTime and next_shard.
+    timespec startTime;
+    int next_shard;
+  };
+
+  static StatsCollector collector;
+
+  // Each thread sticks to the shard it is given the first time it records something.
+  static StatsShard& threadShard()
+  {
+    static thread_local int shard_index = -1;
+    if (shard_index < 0)
+    {
+      tthread::lock_guard<tthread::mutex> guard(collector.mutex);
+      shard_index = collector.next_shard;
+      collector.next_shard = (collector.next_shard + 1) % STATS_SHARDS;
+    }
+    return collector.shards[shard_index];
+  }
+
+  static int bucketIndex(double ms)
+  {
+    double microseconds = ms * 1000;
+    if (!(microseconds >= 1))
+      return 0;
+
+    // microseconds = fraction * 2^exponent, where 0.5 <= fraction < 1
+    int exponent;
+    double fraction = frexp(microseconds, &exponent);
+    int index = 1 + ((exponent - 1) * SUB_BUCKETS) + (int) (((fraction * 2) - 1) * SUB_BUCKETS);
+    return std::min(index, HISTOGRAM_BUCKETS - 1);
+  }
+
+  static double bucketMidpoint(int index)
+  {
+    if (index == 0)
+      return 0.0005;
+
+    int exponent = (index - 1) / SUB_BUCKETS;
+    int sub_bucket = (index - 1) % SUB_BUCKETS;
+    double low = ldexp(1 + ((double) sub_bucket / SUB_BUCKETS), exponent);
+    double high = ldexp(1 + ((double) (sub_bucket + 1) / SUB_BUCKETS), exponent);
+    return (low + high) / 2 / 1000;
+  }
+
+  static double percentile(const StageHistogram& histogram, double fraction)
+  {
+    int64_t target = (int64_t) ceil(histogram.count * fraction);
+    if (target < 1)
+      target = 1;
+
+    int64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+      seen += histogram.buckets[i];
+      if (seen >= target)
+        return std::min(bucketMidpoint(i), histogram.max_ms);
+    }
+    return histogram.max_ms;
+  }
+
+  static bool moreCommon(const AlprDisqualifyCount& a, const AlprDisqualifyCount& b)
+  {
+    if (a.count != b.count)
+      return a.count > b.count;
+    return a.reason < b.reason;
+  }
+
+  void recordStageTime(Config* config, AlprStage stage, timespec startTime)
+  {
+    timespec endTime;
+    getTimeMonotonic(&endTime);
+    double ms = diffclock(startTime, endTime);
+
+    StatsShard& shard = threadShard();
+    {
+      tthread::lock_guard<tthread::mutex> guard(shard.mutex);
+      StageHistogram& histogram = shard.stages[stage];
+      histogram.count++;
+      histogram.total_ms += ms;
+      histogram.max_ms = std::max(histogram.max_ms, ms);
+      histogram.buckets[bucketIndex(ms)]++;
+    }
+
+    if (config != NULL && config->debugTiming)
+      std::cerr << stage_info[stage].label << ": " << ms << "ms." << std::endl;
+  }
+
+  void incrementCounter(AlprCounter counter, int amount)
+  {
+    StatsShard& shard = threadShard();
+    tthread::lock_guard<tthread::mutex> guard(shard.mutex);
+    shard.counters[counter] += amount;
+  }
+
+  void countDisqualified(const std::string& reason)
+  {
+    StatsShard& shard = threadShard();
+    tthread::lock_guard<tthread::mutex> guard(shard.mutex);
+    shard.counters[COUNTER_CANDIDATES_DISQUALIFIED]++;
+    shard.disqualified[reason]++;
+  }
+
+  AlprStats getStatsSnapshot(bool reset)
+  {
+    StageHistogram stages[STAGE_COUNT];
+    int64_t counters[COUNTER_COUNT];
+    std::map<std::string, int64_t> disqualified;
+
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+      stages[i].count = 0;
+      stages[i].total_ms = 0;
+      stages[i].max_ms = 0;
+      std::fill(stages[i].buckets, stages[i].buckets + HISTOGRAM_BUCKETS, 0);
+    }
+    std::fill(counters, counters + COUNTER_COUNT, 0);
+
+    AlprStats stats;
+    {
+      tthread::lock_guard<tthread::mutex> guard(collector.mutex);
+      timespec now;
+      getTimeMonotonic(&now);
+      stats.elapsed_ms = diffclock(collector.startTime, now);
+      if (reset)
+        collector.startTime = now;
+    }
+
+    for (int s = 0; s < STATS_SHARDS; s++)
+    {
+      StatsShard& shard = collector.shards[s];
+      tthread::lock_guard<tthread::mutex> guard(shard.mutex);
+
+      for (int i = 0; i < STAGE_COUNT; i++)
+      {
+        stages[i].count += shard.stages[i].count;
+        stages[i].total_ms += shard.stages[i].total_ms;
+        stages[i].max_ms = std::max(stages[i].max_ms, shard.stages[i].max_ms);
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+          stages[i].buckets[b] += shard.stages[i].buckets[b];
+      }
+      for (int i = 0; i < COUNTER_COUNT; i++)
+        counters[i] += shard.counters[i];
+
+      typedef std::map<std::string, int64_t>::iterator it_type;
+      for (it_type it = shard.disqualified.begin(); it != shard.disqualified.end(); it++)
+        disqualified[it->first] += it->second;
+
+      if (reset)
+        shard.clear();
+    }
+
+    stats.images = counters[COUNTER_IMAGES];
+    stats.candidates_found = counters[COUNTER_CANDIDATES_FOUND];
+    stats.candidates_skipped = counters[COUNTER_CANDIDATES_SKIPPED];
+    stats.candidates_disqualified = counters[COUNTER_CANDIDATES_DISQUALIFIED];
+    stats.candidates_ocrd = counters[COUNTER_CANDIDATES_OCRD];
+    stats.plates_read = counters[COUNTER_PLATES_READ];
+    stats.full_scans = counters[COUNTER_FULL_SCANS];
+    stats.partial_scans = counters[COUNTER_PARTIAL_SCANS];
+
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+      if (stages[i].count == 0)
+        continue;
+
+      AlprStageStats stage;
+      stage.name = stage_info[i].name;
+      stage.count = stages[i].count;
+      stage.total_ms = stages[i].total_ms;
+      stage.max_ms = stages[i].max_ms;
+      stage.p50_ms = percentile(stages[i], 0.50);
+      stage.p95_ms = percentile(stages[i], 0.95);
+      stage.p99_ms = percentile(stages[i], 0.99);
+      stats.stages.push_back(stage);
+    }
+
+    typedef std::map<std::string, int64_t>::iterator it_type;
+    for (it_type it = disqualified.begin(); it != disqualified.end(); it++)
+    {
+      AlprDisqualifyCount reason;
+      reason.reason = it->first;
+      reason.count = it->second;
+      stats.disqualify_reasons.push_back(reason);
+    }
+    std::sort(stats.disqualify_reasons.begin(), stats.disqualify_reasons.end(), moreCommon);
+
+    return stats;
+  }
+
+  void statsToJson(const AlprStats& stats, std::string& buffer)
+  {
+    JsonWriter writer(buffer);
+    writer.beginObject();
+    writer.field("elapsed_ms", stats.elapsed_ms);
+    writer.field("images", (double) stats.images);
+    writer.field("candidates_found", (double) stats.candidates_found);
+    writer.field("candidates_skipped", (double) stats.candidates_skipped);
+    writer.field("candidates_disqualified", (double) stats.candidates_disqualified);
+    writer.field("candidates_ocrd", (double) stats.candidates_ocrd);
+    writer.field("plates_read", (double) stats.plates_read);
+    writer.field("full_scans", (double) stats.full_scans);
+    writer.field("partial_scans", (double) stats.partial_scans);
+
+    writer.key("stages");
+    writer.beginArray();
+    for (unsigned int i = 0; i < stats.stages.size(); i++)
+    {
+      const AlprStageStats& stage = stats.stages[i];
+      writer.beginObject();
+      writer.field("name", stage.name);
+      writer.field("count", (double) stage.count);
+      writer.field("total_ms", stage.total_ms);
+      writer.field("max_ms", stage.max_ms);
+      writer.field("p50_ms", stage.p50_ms);
+      writer.field("p95_ms", stage.p95_ms);
+      writer.field("p99_ms", stage.p99_ms);
+      writer.endObject();
+    }
+    writer.endArray();
+
+    writer.key("disqualify_reasons");
+    writer.beginArray();
+    for (unsigned int i = 0; i < stats.disqualify_reasons.size(); i++)
+    {
+      writer.beginObject();
+      writer.field("reason", stats.disqualify_reasons[i].reason);
+      writer.field("count", (double) stats.disqualify_reasons[i].count);
+      writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+  }
+
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023 V0LT - Conner Vieira
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_STATS_H
+#define OPENALPR_STATS_H
+
+#include <string>
+
+#include "alpr.h"
+#include "config.h"
+#include "support/timing.h"
+
+namespace alpr
+{
+
+  // The stages of the analysis, in the order they happen.  The nested stages are also counted in the stage around them.
+  enum AlprStage
+  {
+    STAGE_IMAGE,
+    STAGE_DETECTION,
+    STAGE_PLATE,
+    STAGE_THRESHOLDS,
+    STAGE_CHARACTER_ANALYSIS,
+    STAGE_CHARACTER_CONTOURS,
+    STAGE_CHARACTER_FILTER,
+    STAGE_COLOR_FILTER,
+    STAGE_PLATE_LINES,
+    STAGE_PLATE_CORNERS,
+    STAGE_HIGH_CONTRAST,
+    STAGE_DESKEW,
+    STAGE_OCR,
+    STAGE_SEGMENTATION,
+    STAGE_SEGMENTATION_HISTOGRAMS,
+    STAGE_SEGMENTATION_CLEANUP,
+    STAGE_POSTPROCESS,
+    STAGE_POSTPROCESS_PERMUTATIONS,
+    STAGE_RESULT_GENERATION,
+
+    STAGE_COUNT
+  };
+
+  enum AlprCounter
+  {
+    COUNTER_IMAGES,
+    COUNTER_CANDIDATES_FOUND,
+    COUNTER_CANDIDATES_SKIPPED,
+    COUNTER_CANDIDATES_DISQUALIFIED,
+    COUNTER_CANDIDATES_OCRD,
+    COUNTER_PLATES_READ,
+    COUNTER_FULL_SCANS,
+    COUNTER_PARTIAL_SCANS,
+
+    COUNTER_COUNT
+  };
+
+  // Records the time from startTime until now for the stage.  Each thread records into its own set of histograms,
+  // so threads rarely wait on each other.  With debug_timing on, the time is also printed to stderr.
+  void recordStageTime(Config* config, AlprStage stage, timespec startTime);
+
+  void incrementCounter(AlprCounter counter, int amount = 1);
+
+  // Counts a candidate that was disqualified, along with its disqualify_reason.
+  void countDisqualified(const std::string& reason);
+
+  // Combines what every thread has recorded.  With 'reset', collection starts over.
+  AlprStats getStatsSnapshot(bool reset);
+
+  // Appends the statistics as a single line of JSON.
+  void statsToJson(const AlprStats& stats, std::string& buffer);
+
+}
+
+#endif // OPENALPR_STATS_H
@@ -0,0 +1,122 @@
+#include "taskpool.h"
+
+namespace alpr
+{
+
+  // The group of the task this thread is running, if any.
+  static thread_local TaskGroup* running_group = NULL;
+
+  TaskPool::TaskPool(unsigned int num_threads)
+  {
+    stopping = false;
+    for (unsigned int i = 0; i < num_threads; i++)
+      threads.push_back(new tthread::thread(worker_thread, this));
+  }
+
+  TaskPool::~TaskPool()
+  {
+    {
+      tthread::lock_guard<tthread::mutex> guard(pool_mutex);
+      stopping = true;
+      task_available.notify_all();
+    }
+
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+      threads[i]->join();
+      delete threads[i];
+    }
+  }
+
+  void TaskPool::run(TaskGroup* group, void (*func)(void*), void* arg)
+  {
+    Task task;
+    task.func = func;
+    task.arg = arg;
+    task.group = group;
+
+    tthread::lock_guard<tthread::mutex> guard(pool_mutex);
+    group->parent = running_group;
+    group->pending++;
+    tasks.push_back(task);
+    task_available.notify_one();
+  }
+
+  void TaskPool::wait(TaskGroup* group)
+  {
+    pool_mutex.lock();
+    while (group->pending > 0)
+    {
+      Task task;
+      if (takeTask(group, task))
+      {
+        // Help out instead of sitting idle.
+        pool_mutex.unlock();
+        finish(task);
+        pool_mutex.lock();
+      }
+      else
+      {
+        task_finished.wait(pool_mutex);
+      }
+    }
+    pool_mutex.unlock();
+  }
+
+  unsigned int TaskPool::size()
+  {
+    return threads.size();
+  }
+
+  bool TaskPool::takeTask(TaskGroup* group, Task& task)
+  {
+    for (std::deque<Task>::iterator it = tasks.begin(); it != tasks.end(); ++it)
+    {
+      for (TaskGroup* g = it->group; g != NULL; g = g->parent)
+      {
+        if (g == group)
+        {
+          task = *it;
+          tasks.erase(it);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void TaskPool::finish(Task task)
+  {
+    TaskGroup* outer_group = running_group;
+    running_group = task.group;
+    task.func(task.arg);
+    running_group = outer_group;
+
+    tthread::lock_guard<tthread::mutex> guard(pool_mutex);
+    task.group->pending--;
+    task_finished.notify_all();
+  }
+
+  void TaskPool::worker_thread(void* arg)
+  {
+    TaskPool* pool = (TaskPool*) arg;
+
+    pool->pool_mutex.lock();
+    while (true)
+    {
+      while (pool->tasks.size() == 0 && !pool->stopping)
+        pool->task_available.wait(pool->pool_mutex);
+
+      if (pool->tasks.size() == 0)
+        break;
+
+      Task task = pool->tasks.front();
+      pool->tasks.pop_front();
+      pool->pool_mutex.unlock();
+      pool->finish(task);
+      pool->pool_mutex.lock();
+    }
+    pool->pool_mutex.unlock();
+  }
+
+}
@@ -0,0 +1,73 @@
+#ifndef OPENALPR_TASKPOOL_H
+#define OPENALPR_TASKPOOL_H
+
+#include <deque>
+#include <vector>
+
+#include "tinythread.h"
+
+namespace alpr
+{
+
+  // A set of tasks that can be waited on together.
+  class TaskGroup
+  {
+    public:
+      TaskGroup() { pending = 0; parent = NULL; }
+
+    private:
+      friend class TaskPool;
+      unsigned int pending;
+
+      // The group of the task that queued this group's tasks, or NULL when they were queued from outside the pool.
+      TaskGroup* parent;
+  };
+
+  // A fixed set of worker threads that run short tasks.
+  // A thread that waits on a group runs the group's queued tasks itself until the group is finished, so tasks
+  // may safely start and wait on their own groups of tasks without tying up every worker.  It only helps with
+  // tasks of its own group and of the groups nested inside it, so a wait never takes on someone else's work.
+  class TaskPool
+  {
+    public:
+      // A pool with 0 threads runs every task on the thread that waits for it.
+      TaskPool(unsigned int num_threads);
+      virtual ~TaskPool();
+
+      // Queues a task as part of the group.  Tasks must not throw.
+      void run(TaskGroup* group, void (*func)(void*), void* arg);
+      void wait(TaskGroup* group);
+
+      unsigned int size();
+
+    private:
+      struct Task
+      {
+        void (*func)(void*);
+        void* arg;
+        TaskGroup* group;
+      };
+
+      static void worker_thread(void* arg);
+
+      // Runs the task, and marks it finished.  Called without holding the lock.
+      void finish(Task task);
+
+      // Takes the oldest queued task of the group, or of a group nested inside it.  Called holding the lock.
+      bool takeTask(TaskGroup* group, Task& task);
+
+      std::deque<Task> tasks;
+      std::vector<tthread::thread*> threads;
+      bool stopping;
+
+      tthread::mutex pool_mutex;
+      tthread::condition_variable task_available;
+      tthread::condition_variable task_finished;
+
+      TaskPool(const TaskPool&);
+      TaskPool& operator=(const TaskPool&);
+  };
+
+}
+
+#endif // OPENALPR_TASKPOOL_H
@@ -0,0 +1,80 @@
+#include "workqueue.h"
+
+namespace alpr
+{
+
+  WorkQueue::WorkQueue(unsigned int num_threads, unsigned int capacity)
+  {
+    this->capacity = capacity;
+    if (this->capacity < 1)
+      this->capacity = 1;
+    if (num_threads < 1)
+      num_threads = 1;
+
+    stopping = false;
+    for (unsigned int i = 0; i < num_threads; i++)
+      threads.push_back(new tthread::thread(worker_thread, this));
+  }
+
+  WorkQueue::~WorkQueue()
+  {
+    {
+      tthread::lock_guard<tthread::mutex> guard(queue_mutex);
+      stopping = true;
+      job_available.notify_all();
+    }
+
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+      threads[i]->join();
+      delete threads[i];
+    }
+  }
+
+  void WorkQueue::submit(void (*func)(void*), void* arg)
+  {
+    Job job;
+    job.func = func;
+    job.arg = arg;
+
+    tthread::lock_guard<tthread::mutex> guard(queue_mutex);
+    while (jobs.size() >= capacity)
+      not_full.wait(queue_mutex);
+
+    jobs.push_back(job);
+    job_available.notify_one();
+  }
+
+  unsigned int WorkQueue::size()
+  {
+    tthread::lock_guard<tthread::mutex> guard(queue_mutex);
+    return jobs.size();
+  }
+
+  void WorkQueue::worker_thread(void* arg)
+  {
+    WorkQueue* queue = (WorkQueue*) arg;
+
+    queue->queue_mutex.lock();
+    while (true)
+    {
+      while (queue->jobs.size() == 0 && !queue->stopping)
+        queue->job_available.wait(queue->queue_mutex);
+
+      // Once stopping, the remaining jobs are still run before the worker exits.
+      if (queue->jobs.size() == 0)
+        break;
+
+      Job job = queue->jobs.front();
+      queue->jobs.pop_front();
+      queue->not_full.notify_one();
+      queue->queue_mutex.unlock();
+
+      job.func(job.arg);
+
+      queue->queue_mutex.lock();
+    }
+    queue->queue_mutex.unlock();
+  }
+
+}
@@ -0,0 +1,51 @@
+#ifndef OPENALPR_WORKQUEUE_H
+#define OPENALPR_WORKQUEUE_H
+
+#include <deque>
+#include <vector>
+
+#include "tinythread.h"
+
+namespace alpr
+{
+
+  // A fixed set of worker threads fed by a bounded queue of jobs.
+  // Submitting a job to a full queue waits until a worker takes a job off of it.
+  class WorkQueue
+  {
+    public:
+      WorkQueue(unsigned int num_threads, unsigned int capacity);
+
+      // Waits for every queued job to finish.
+      virtual ~WorkQueue();
+
+      // Jobs must not throw.
+      void submit(void (*func)(void*), void* arg);
+
+      unsigned int size();
+
+    private:
+      struct Job
+      {
+        void (*func)(void*);
+        void* arg;
+      };
+
+      static void worker_thread(void* arg);
+
+      std::deque<Job> jobs;
+      std::vector<tthread::thread*> threads;
+      unsigned int capacity;
+      bool stopping;
+
+      tthread::mutex queue_mutex;
+      tthread::condition_variable job_available;
+      tthread::condition_variable not_full;
+
+      WorkQueue(const WorkQueue&);
+      WorkQueue& operator=(const WorkQueue&);
+  };
+
+}
+
+#endif // OPENALPR_WORKQUEUE_H
@@ -20,6 +20,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include "characteranalysis.h"
+#include "stats.h"
 #include "linefinder.h"
 
 using namespace cv;
@@ -69,12 +70,7 @@ namespace alpr
       allTextContours.push_back(tc);
     }
 
-    if (config->debugTiming)
-    {
-      timespec contoursEndTime;
-      getTimeMonotonic(&contoursEndTime);
-      cout << "  -- Character Analysis Find Contours Time: " << diffclock(contoursStartTime, contoursEndTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_CHARACTER_CONTOURS, contoursStartTime);
     //Mat img_equalized = equalizeBrightness(img_gray);
 
     timespec filterStartTime;
@@ -88,12 +84,7 @@ namespace alpr
         cout << "Threshold " << i << " had " << allTextContours[i].getGoodIndicesCount() << " good indices." << endl;
     }
 
-    if (config->debugTiming)
-    {
-      timespec filterEndTime;
-      getTimeMonotonic(&filterEndTime);
-      cout << "  -- Character Analysis Filter Time: " << diffclock(filterStartTime, filterEndTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_CHARACTER_FILTER, filterStartTime);
 
     PlateMask plateMask(pipeline_data);
     plateMask.findOuterBoxMask(allTextContours);
@@ -238,12 +229,7 @@ namespace alpr
         pipeline_data->disqualify_reason = "No text lines found in characteranalysis";
     }
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "Character Analysis Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_CHARACTER_ANALYSIS, startTime);
 
     // Draw debug dashboard
     if (this->pipeline_data->config->debugCharAnalysis && pipeline_data->textLines.size() > 0)
@@ -19,6 +19,7 @@
 #include <cctype>
 
 #include "utility.h"
+#include "stats.h"
 
 using namespace cv;
 using namespace std;
@@ -47,6 +48,29 @@ namespace alpr
     return expandedRegion;
   }
 
+  vector<Rect> mergeOverlappingRects(vector<Rect> regions)
+  {
+    bool merged = true;
+    while (merged)
+    {
+      merged = false;
+      for (unsigned int i = 0; i < regions.size() && !merged; i++)
+      {
+        for (unsigned int j = i + 1; j < regions.size(); j++)
+        {
+          if ((regions[i] & regions[j]).area() > 0)
+          {
+            regions[i] = regions[i] | regions[j];
+            regions.erase(regions.begin() + j);
+            merged = true;
+            break;
+          }
+        }
+      }
+    }
+    return regions;
+  }
+
   Mat drawImageDashboard(vector<Mat> images, int imageType, unsigned int numColumns)
   {
     unsigned int numRows = ceil((float) images.size() / (float) numColumns);
@@ -158,12 +182,7 @@ namespace alpr
     //NiblackSauvolaWolfJolion (img_gray, thresholds[i++], SAUVOLA, 12, 12, 0.18 * k);
     //bitwise_not(thresholds[i-1], thresholds[i-1]);
 
-    if (config->debugTiming)
-    {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      cout << "  -- Produce Threshold Time: " << diffclock(startTime, endTime) << "ms." << endl;
-    }
+    recordStageTime(config, STAGE_THRESHOLDS, startTime);
 
     return thresholds;
     //threshold(img_equalized, img_threshold, 100, 255, THRESH_BINARY);
@@ -96,6 +96,9 @@ namespace alpr
 
   cv::Rect expandRect(cv::Rect original, int expandXPixels, int expandYPixels, int maxX, int maxY);
 
+  // Replaces every group of overlapping rectangles with the one rectangle that bounds them.
+  std::vector<cv::Rect> mergeOverlappingRects(std::vector<cv::Rect> regions);
+
   cv::Mat addLabel(cv::Mat input, std::string label);
 
   // Given 4 random points (Point2f array), order them as top-left, top-right, bottom-right, bottom-left
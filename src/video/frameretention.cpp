@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "frameretention.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+FrameRetention::FrameRetention(std::string directory, int max_age_seconds, size_t max_count)
+{
+  this->directory = directory;
+  this->max_age_seconds = max_age_seconds;
+  this->max_count = max_count;
+}
+
+FrameRetention::~FrameRetention()
+{
+}
+
+void FrameRetention::sweep()
+{
+  DIR* dir = opendir(directory.c_str());
+  if (!dir)
+  {
+    std::cerr << "{\"error\": \"Error opening directory: " << strerror(errno) << "\"}" << std::endl;
+    return;
+  }
+
+  time_t threshold = time(NULL) - max_age_seconds; // Determine the threshold, under which files will be deleted.
+
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+
+    std::string filePath = directory + "/" + entry->d_name;
+    struct stat fileStat;
+
+    if (stat(filePath.c_str(), &fileStat) != 0)
+    {
+      std::cerr << "{\"error\": \"Error getting file status: " << filePath << " - " << strerror(errno) << "\"}" << std::endl;
+      continue;
+    }
+
+    if (fileStat.st_mtime < threshold && remove(filePath.c_str()) != 0)
+      std::cerr << "{\"error\": \"Error deleting file: " << filePath << " - " << strerror(errno) << "\"}" << std::endl;
+  }
+
+  closedir(dir);
+}
+
+void FrameRetention::add(std::string identifier, std::string file_name)
+{
+  RetainedFrame frame;
+  frame.identifier = identifier;
+  frame.file_name = file_name;
+  frame.written = time(NULL);
+
+  {
+    tthread::lock_guard<tthread::mutex> guard(mMutex);
+    frames.push_back(frame);
+  }
+
+  expire();
+}
+
+void FrameRetention::expire()
+{
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+
+  time_t threshold = time(NULL) - max_age_seconds;
+
+  // Frames are recorded in the order they were written, so only the front of the queue can have expired.
+  while (!frames.empty() && (frames.front().written < threshold || (max_count > 0 && frames.size() > max_count)))
+  {
+    removeFrame(frames.front());
+    frames.pop_front();
+  }
+}
+
+size_t FrameRetention::size()
+{
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+  return frames.size();
+}
+
+void FrameRetention::removeFrame(const RetainedFrame& frame)
+{
+  std::string filePath = directory + "/" + frame.file_name;
+
+  if (remove(filePath.c_str()) != 0 && errno != ENOENT)
+    std::cerr << "{\"error\": \"Error deleting file: " << filePath << " - " << strerror(errno) << "\"}" << std::endl;
+}
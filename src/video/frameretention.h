@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_FRAMERETENTION_H
+#define OPENALPR_FRAMERETENTION_H
+
+#include <ctime>
+#include <deque>
+#include <string>
+
+#include "support/tinythread.h"
+
+// Keeps track of the frames saved to a directory, and deletes them once they are too old or there are too many.
+// Frames are recorded in the order they were written, so expiring them only ever looks at the oldest entries,
+// and the directory itself only has to be scanned once at startup.
+class FrameRetention
+{
+  public:
+    // A max_count of 0 keeps any number of frames, as long as they are newer than max_age_seconds.
+    FrameRetention(std::string directory, int max_age_seconds, size_t max_count);
+    virtual ~FrameRetention();
+
+    // Deletes every file in the directory older than max_age_seconds, including files left behind by previous runs.
+    void sweep();
+
+    // Records a frame that was just written to the directory, then deletes any frames that have expired.
+    void add(std::string identifier, std::string file_name);
+
+    // Deletes the frames that are older than max_age_seconds, or beyond max_count.
+    void expire();
+
+    // The number of frames currently being kept.
+    size_t size();
+
+  private:
+    struct RetainedFrame
+    {
+      std::string identifier;
+      std::string file_name;
+      time_t written;
+    };
+
+    void removeFrame(const RetainedFrame& frame);
+
+    std::string directory;
+    int max_age_seconds;
+    size_t max_count;
+
+    std::deque<RetainedFrame> frames; // Oldest first.
+    tthread::mutex mMutex;
+};
+
+#endif // OPENALPR_FRAMERETENTION_H
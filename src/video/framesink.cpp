@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "framesink.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+FrameSink::FrameSink(std::string still_path, std::string frame_directory, FrameSinkFormat format, int jpeg_quality, FrameRetention* retention)
+{
+  this->still_path = still_path;
+  this->frame_directory = frame_directory;
+  this->format = format;
+  this->retention = retention;
+
+  if (format == FRAME_SINK_JPEG)
+  {
+    encode_params.push_back(cv::IMWRITE_JPEG_QUALITY);
+    encode_params.push_back(jpeg_quality);
+  }
+
+  has_pending = false;
+  busy = false;
+  active = true;
+  skipped_frames = 0;
+
+  writer = new tthread::thread(writerThread, (void*) this);
+}
+
+FrameSink::~FrameSink()
+{
+  {
+    tthread::lock_guard<tthread::mutex> guard(mMutex);
+    active = false;
+    frameQueued.notify_all();
+  }
+
+  // The writer thread finishes the frame it was given before exiting.
+  writer->join();
+  delete writer;
+}
+
+bool FrameSink::submit(const cv::Mat& frame, std::string identifier)
+{
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+
+  if (identifier.empty())
+  {
+    if (has_pending || busy)
+    {
+      skipped_frames++;
+      return false;
+    }
+  }
+  else
+  {
+    // A pending frame with an identifier still has to be written, but a pending still-only frame can be replaced.
+    while (has_pending && !pending_identifier.empty())
+      slotFree.wait(mMutex);
+  }
+
+  // The caller may reuse its buffer as soon as this returns, so take a copy.  copyTo() reuses the
+  // pending buffer's allocation when the frame size doesn't change.
+  frame.copyTo(pending_frame);
+  pending_identifier = identifier;
+  has_pending = true;
+  frameQueued.notify_one();
+
+  return true;
+}
+
+void FrameSink::waitUntilWritten(std::string identifier)
+{
+  if (identifier.empty())
+    return;
+
+  // Frames with an identifier are never skipped, so once it is neither pending nor being written, it has been written.
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+  while ((has_pending && pending_identifier == identifier) || (busy && writing_identifier == identifier))
+    frameWritten.wait(mMutex);
+}
+
+std::string FrameSink::extension(const cv::Mat& frame)
+{
+  if (format == FRAME_SINK_RAW)
+    return (frame.channels() == 1) ? ".pgm" : ".ppm";
+
+  return ".jpg";
+}
+
+unsigned long FrameSink::skipped()
+{
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+  return skipped_frames;
+}
+
+void FrameSink::writerThread(void* arg)
+{
+  FrameSink* sink = (FrameSink*) arg;
+
+  // Frames are swapped between these two buffers, so neither has to be reallocated while the frame size stays the same.
+  cv::Mat frame;
+  std::string identifier;
+
+  sink->mMutex.lock();
+  while (true)
+  {
+    while (!sink->has_pending && sink->active)
+      sink->frameQueued.wait(sink->mMutex);
+
+    if (!sink->has_pending)
+      break;
+
+    cv::swap(frame, sink->pending_frame);
+    identifier = sink->pending_identifier;
+    sink->has_pending = false;
+    sink->busy = true;
+    sink->writing_identifier = identifier;
+    sink->slotFree.notify_all();
+    sink->mMutex.unlock();
+
+    sink->writeFrame(frame, identifier);
+
+    sink->mMutex.lock();
+    sink->busy = false;
+    sink->writing_identifier.clear();
+    sink->frameWritten.notify_all();
+  }
+  sink->mMutex.unlock();
+}
+
+void FrameSink::writeFrame(const cv::Mat& frame, std::string identifier)
+{
+  std::string ext = extension(frame);
+
+  std::vector<uchar> data;
+  if (!cv::imencode(ext, frame, data, encode_params))
+  {
+    std::cerr << "{\"error\": \"Error encoding frame\"}" << std::endl;
+    return;
+  }
+
+  writeFile(still_path + ext, data);
+
+  if (!identifier.empty() && !frame_directory.empty())
+  {
+    if (writeFile(frame_directory + "/" + identifier + ext, data) && retention != NULL)
+      retention->add(identifier, identifier + ext);
+  }
+}
+
+// Writes to a temporary file first, so readers never see a partially written frame.
+bool FrameSink::writeFile(std::string path, const std::vector<uchar>& data)
+{
+  std::string temp_path = path + ".tmp";
+
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (file == NULL)
+  {
+    std::cerr << "{\"error\": \"Error writing frame: " << temp_path << " - " << strerror(errno) << "\"}" << std::endl;
+    return false;
+  }
+
+  size_t written = fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+
+  if (written != data.size() || rename(temp_path.c_str(), path.c_str()) != 0)
+  {
+    std::cerr << "{\"error\": \"Error writing frame: " << path << " - " << strerror(errno) << "\"}" << std::endl;
+    remove(temp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_FRAMESINK_H
+#define OPENALPR_FRAMESINK_H
+
+#include <string>
+#include <vector>
+
+#include "opencv2/highgui/highgui.hpp"
+
+#include "support/tinythread.h"
+#include "frameretention.h"
+
+enum FrameSinkFormat
+{
+  FRAME_SINK_JPEG, // Compressed JPEG files (.jpg).
+  FRAME_SINK_RAW   // Uncompressed PPM/PGM files (.ppm/.pgm), which skip the compression step entirely.
+};
+
+// Writes analyzed frames to disk on a background thread, so that encoding never holds up recognition.
+// Each frame is encoded once, and the same bytes are written to the shared still and, when an identifier
+// is given, to a per-frame file.
+class FrameSink
+{
+  public:
+    // still_path and frame_directory are given without a file extension.  An empty frame_directory disables per-frame files.
+    // When a retention manager is given, every per-frame file is recorded with it so that it is deleted once it expires.
+    FrameSink(std::string still_path, std::string frame_directory, FrameSinkFormat format, int jpeg_quality, FrameRetention* retention = NULL);
+    virtual ~FrameSink();
+
+    // Queues a frame to be written.  Frames without an identifier only update the shared still, and are skipped
+    // if the previous frame hasn't been written yet.  Frames with an identifier are always written, and wait for
+    // the previous frame to be picked up by the writer thread if necessary.  Returns false if the frame was skipped.
+    bool submit(const cv::Mat& frame, std::string identifier);
+
+    // Waits until the frame submitted with this identifier has been written (or failed to be written), so that
+    // its file exists before the identifier is published.
+    void waitUntilWritten(std::string identifier);
+
+    // Returns the file extension used for the given frame, including the leading dot.
+    std::string extension(const cv::Mat& frame);
+
+    // The number of frames that were skipped because the previous encode was still pending.
+    unsigned long skipped();
+
+  private:
+    static void writerThread(void* arg);
+    void writeFrame(const cv::Mat& frame, std::string identifier);
+    bool writeFile(std::string path, const std::vector<uchar>& data);
+
+    std::string still_path;
+    std::string frame_directory;
+    FrameSinkFormat format;
+    std::vector<int> encode_params;
+    FrameRetention* retention;
+
+    cv::Mat pending_frame;
+    std::string pending_identifier;
+    std::string writing_identifier;
+    bool has_pending;
+    bool busy;
+    bool active;
+    unsigned long skipped_frames;
+
+    tthread::mutex mMutex;
+    tthread::condition_variable frameQueued;
+    tthread::condition_variable slotFree;
+    tthread::condition_variable frameWritten;
+    tthread::thread* writer;
+};
+
+#endif // OPENALPR_FRAMESINK_H
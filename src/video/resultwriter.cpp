@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resultwriter.h"
+
+#include "support/platform.h"
+#include "support/timing.h"
+
+using namespace alpr;
+
+ResultWriter::ResultWriter(FILE* output, bool flush_each, size_t flush_bytes, int flush_interval_ms)
+{
+  this->output = output;
+  this->flush_each = flush_each || flush_interval_ms <= 0;
+  this->flush_bytes = flush_bytes;
+  this->flush_interval_ms = flush_interval_ms;
+
+  buffer.reserve(flush_bytes + 4096);
+  first_buffered_ms = 0;
+  active = true;
+
+  // Lines are also flushed when nothing else is written for a while, so a quiet stream doesn't hold back its last results.
+  flusher = NULL;
+  if (!this->flush_each)
+    flusher = new tthread::thread(flushThread, (void*) this);
+}
+
+ResultWriter::~ResultWriter()
+{
+  {
+    tthread::lock_guard<tthread::mutex> guard(mMutex);
+    active = false;
+  }
+
+  if (flusher != NULL)
+  {
+    flusher->join();
+    delete flusher;
+  }
+
+  flush();
+}
+
+void ResultWriter::write(const std::string& line)
+{
+  beginLine().append(line);
+  endLine();
+}
+
+std::string& ResultWriter::beginLine()
+{
+  mMutex.lock();
+
+  if (buffer.empty())
+    first_buffered_ms = getEpochTimeMs();
+
+  return buffer;
+}
+
+void ResultWriter::endLine()
+{
+  buffer.push_back('\n');
+
+  if (flush_each || buffer.size() >= flush_bytes || getEpochTimeMs() - first_buffered_ms >= flush_interval_ms)
+    flushLocked();
+
+  mMutex.unlock();
+}
+
+void ResultWriter::flush()
+{
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+  flushLocked();
+}
+
+void ResultWriter::flushThread(void* arg)
+{
+  ResultWriter* writer = (ResultWriter*) arg;
+
+  while (true)
+  {
+    sleep_ms(writer->flush_interval_ms);
+
+    tthread::lock_guard<tthread::mutex> guard(writer->mMutex);
+    if (!writer->active)
+      break;
+
+    if (!writer->buffer.empty() && getEpochTimeMs() - writer->first_buffered_ms >= writer->flush_interval_ms)
+      writer->flushLocked();
+  }
+}
+
+void ResultWriter::flushLocked()
+{
+  if (buffer.empty())
+    return;
+
+  fwrite(buffer.data(), 1, buffer.size(), output);
+  fflush(output);
+
+  // clear() keeps the allocation, so the buffer is reused for the next batch.
+  buffer.clear();
+}
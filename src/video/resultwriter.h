@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_RESULTWRITER_H
+#define OPENALPR_RESULTWRITER_H
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+
+#include "support/tinythread.h"
+
+// Writes one line of output per result, collecting the lines in a reusable buffer and writing them out in
+// batches.  The buffer is flushed once it reaches flush_bytes, or once its oldest line has waited
+// flush_interval_ms, whichever comes first.  With flush_each, or a flush_interval_ms of 0, every line is written out
+// immediately.
+class ResultWriter
+{
+  public:
+    ResultWriter(FILE* output, bool flush_each, size_t flush_bytes, int flush_interval_ms);
+    virtual ~ResultWriter();
+
+    // Adds a line to the output.  The newline is added by the writer.
+    void write(const std::string& line);
+
+    // Locks the writer and returns its buffer, so a line can be serialized straight into it instead of into a
+    // string of its own first.  Every call must be followed by endLine(), which adds the newline and unlocks the writer.
+    std::string& beginLine();
+    void endLine();
+
+    // Writes out everything that has been buffered so far.
+    void flush();
+
+  private:
+    static void flushThread(void* arg);
+    void flushLocked();
+
+    FILE* output;
+    bool flush_each;
+    size_t flush_bytes;
+    int flush_interval_ms;
+
+    std::string buffer;
+    int64_t first_buffered_ms; // The time the oldest line in the buffer was written.
+    bool active;
+
+    tthread::mutex mMutex;
+    tthread::thread* flusher;
+};
+
+#endif // OPENALPR_RESULTWRITER_H
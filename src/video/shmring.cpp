@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "shmring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Slots are aligned to cache lines, so that the pixel data of each slot starts on an aligned address.
+static uint64_t alignSize(uint64_t size)
+{
+  return (size + 63) & ~((uint64_t) 63);
+}
+
+ShmRing::ShmRing()
+{
+  owner = false;
+  fd = -1;
+  memory = NULL;
+  memory_size = 0;
+  header = NULL;
+  rejected_frames = 0;
+}
+
+ShmRing::~ShmRing()
+{
+  close();
+}
+
+bool ShmRing::create(std::string name, uint32_t slot_count, uint64_t frame_capacity, uint64_t results_capacity)
+{
+#ifdef WINDOWS
+  std::cerr << "{\"error\": \"Shared memory output is not supported on this platform\"}" << std::endl;
+  return false;
+#else
+  close();
+
+  if (slot_count == 0)
+    return false;
+
+  uint64_t slots_offset = alignSize(sizeof(ShmRingHeader));
+  uint64_t slot_size = alignSize(alignSize(sizeof(ShmRingSlot)) + frame_capacity + results_capacity);
+  size_t size = slots_offset + slot_size * slot_count;
+
+  std::string path = "/" + name;
+  shm_unlink(path.c_str()); // Start from a clean object, in case a previous run used a different layout.
+  fd = shm_open(path.c_str(), O_CREAT | O_RDWR, 0666);
+  if (fd < 0 || ftruncate(fd, size) != 0)
+  {
+    std::cerr << "{\"error\": \"Error creating shared memory: " << name << " - " << strerror(errno) << "\"}" << std::endl;
+    close();
+    return false;
+  }
+
+  memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED)
+  {
+    memory = NULL;
+    std::cerr << "{\"error\": \"Error mapping shared memory: " << name << " - " << strerror(errno) << "\"}" << std::endl;
+    close();
+    return false;
+  }
+
+  this->name = name;
+  this->owner = true;
+  this->memory_size = size;
+
+  // ftruncate() fills the new object with zeros, so every slot starts out empty.
+  header = (ShmRingHeader*) memory;
+  header->version = SHM_RING_VERSION;
+  header->slot_count = slot_count;
+  header->slot_size = slot_size;
+  header->slots_offset = slots_offset;
+  header->frame_capacity = frame_capacity;
+  header->results_capacity = results_capacity;
+  header->latest_sequence = 0;
+
+  // The magic is written last, so readers never map a half-initialized header.
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(header->magic, SHM_RING_MAGIC, sizeof(header->magic));
+
+  return true;
+#endif
+}
+
+bool ShmRing::open(std::string name)
+{
+#ifdef WINDOWS
+  return false;
+#else
+  close();
+
+  std::string path = "/" + name;
+  fd = shm_open(path.c_str(), O_RDONLY, 0);
+  struct stat fileStat;
+  if (fd < 0 || fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < sizeof(ShmRingHeader))
+  {
+    close();
+    return false;
+  }
+
+  memory = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED)
+  {
+    memory = NULL;
+    close();
+    return false;
+  }
+
+  this->name = name;
+  this->owner = false;
+  this->memory_size = fileStat.st_size;
+
+  header = (ShmRingHeader*) memory;
+  if (memcmp(header->magic, SHM_RING_MAGIC, sizeof(header->magic)) != 0 || header->version != SHM_RING_VERSION ||
+      header->slots_offset + header->slot_size * header->slot_count > memory_size)
+  {
+    close();
+    return false;
+  }
+
+  return true;
+#endif
+}
+
+bool ShmRing::write(const cv::Mat& frame, std::string identifier, int64_t epoch_time, const std::string& results)
+{
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+
+  if (header == NULL || !owner)
+    return false;
+
+  uint64_t frame_bytes = (uint64_t) frame.cols * frame.rows * frame.elemSize();
+  if (frame_bytes > header->frame_capacity || results.size() > header->results_capacity)
+  {
+    rejected_frames++;
+    return false;
+  }
+
+  uint64_t sequence = header->latest_sequence + 1;
+  ShmRingSlot* slot = slotAt(sequence);
+
+  // Mark the slot as being written before touching its contents.  The fence keeps the writes below from being seen
+  // before the mark, so a reader that copied them sees the sequence change.
+  __atomic_store_n(&slot->sequence, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  slot->epoch_time = epoch_time;
+  memset(slot->identifier, 0, sizeof(slot->identifier));
+  strncpy(slot->identifier, identifier.c_str(), sizeof(slot->identifier) - 1);
+  slot->width = frame.cols;
+  slot->height = frame.rows;
+  slot->channels = frame.channels();
+  slot->frame_bytes = frame_bytes;
+  slot->results_bytes = results.size();
+
+  unsigned char* data = ((unsigned char*) slot) + alignSize(sizeof(ShmRingSlot));
+  if (frame.isContinuous())
+  {
+    memcpy(data, frame.data, frame_bytes);
+  }
+  else
+  {
+    size_t row_bytes = frame.cols * frame.elemSize();
+    for (int y = 0; y < frame.rows; y++)
+      memcpy(data + y * row_bytes, frame.ptr(y), row_bytes);
+  }
+  memcpy(data + frame_bytes, results.data(), results.size());
+
+  __atomic_store_n(&slot->sequence, sequence, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->latest_sequence, sequence, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+bool ShmRing::read(std::string identifier, cv::Mat& frame, std::string& results)
+{
+  if (header == NULL)
+    return false;
+
+  uint64_t latest = __atomic_load_n(&header->latest_sequence, __ATOMIC_ACQUIRE);
+
+  // Search from the newest slot backwards, since consumers usually ask for recent frames.
+  for (uint64_t sequence = latest; sequence > 0 && sequence + header->slot_count > latest; sequence--)
+  {
+    ShmRingSlot* slot = slotAt(sequence);
+
+    uint64_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    if (before != sequence || strncmp(slot->identifier, identifier.c_str(), sizeof(slot->identifier)) != 0)
+      continue;
+
+    ShmRingSlot copy = *slot;
+    if (copy.frame_bytes > header->frame_capacity || copy.results_bytes > header->results_capacity ||
+        (uint64_t) copy.width * copy.height * copy.channels != copy.frame_bytes)
+      return false;
+
+    unsigned char* data = ((unsigned char*) slot) + alignSize(sizeof(ShmRingSlot));
+    frame.create(copy.height, copy.width, (copy.channels == 1) ? CV_8UC1 : CV_8UC3);
+    memcpy(frame.data, data, copy.frame_bytes);
+    results.assign((const char*) data + copy.frame_bytes, copy.results_bytes);
+
+    // If the writer reused the slot while it was being copied, the copy can't be trusted.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t after = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    return (after == before);
+  }
+
+  return false;
+}
+
+bool ShmRing::isOpen()
+{
+  return header != NULL;
+}
+
+unsigned long ShmRing::rejected()
+{
+  tthread::lock_guard<tthread::mutex> guard(mMutex);
+  return rejected_frames;
+}
+
+ShmRingSlot* ShmRing::slotAt(uint64_t sequence)
+{
+  uint64_t index = (sequence - 1) % header->slot_count;
+  return (ShmRingSlot*) (((unsigned char*) memory) + header->slots_offset + index * header->slot_size);
+}
+
+void ShmRing::close()
+{
+#ifndef WINDOWS
+  if (memory != NULL)
+    munmap(memory, memory_size);
+
+  if (fd >= 0)
+    ::close(fd);
+
+  // The shared memory object is left in place when the writer exits, so consumers can still read the last frames.
+#endif
+
+  memory = NULL;
+  memory_size = 0;
+  header = NULL;
+  fd = -1;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023 Conner Vieira - V0LT.
+ *
+ * Phantom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_SHMRING_H
+#define OPENALPR_SHMRING_H
+
+#include <stdint.h>
+#include <string>
+
+#include "opencv2/core/core.hpp"
+
+#include "support/tinythread.h"
+
+#define SHM_RING_MAGIC "PHNTRING"
+#define SHM_RING_VERSION 1
+#define SHM_RING_IDENTIFIER_LENGTH 32
+
+// The shared memory layout is a ShmRingHeader, followed by slot_count slots of slot_size bytes each,
+// starting at slots_offset.  Each slot is a ShmRingSlot, followed by the raw frame pixels (rows packed
+// without padding, BGR or gray depending on channels), followed by the serialized results.
+//
+// Slots are written in order, and each write gets the next sequence number.  A slot's sequence is set to
+// 0 while it is being written, so readers should read the sequence, copy the slot, then read the sequence
+// again, and discard the copy if the two don't match or are 0.
+struct ShmRingHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t slot_count;
+  uint64_t slot_size;
+  uint64_t slots_offset;
+  uint64_t frame_capacity;   // The maximum number of frame bytes in each slot.
+  uint64_t results_capacity; // The maximum number of results bytes in each slot.
+  uint64_t latest_sequence;  // The sequence number of the most recently completed slot, or 0 if none has been written.
+};
+
+struct ShmRingSlot
+{
+  uint64_t sequence;
+  int64_t epoch_time;
+  char identifier[SHM_RING_IDENTIFIER_LENGTH]; // Matches the "identifier" field of the JSON results.  Null-terminated.
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;
+  uint32_t reserved;
+  uint64_t frame_bytes;
+  uint64_t results_bytes;
+};
+
+// A ring buffer of frames and results in POSIX shared memory, so that local programs can read analyzed frames
+// without encoding or decoding images, or parsing stdout.
+class ShmRing
+{
+  public:
+    ShmRing();
+    virtual ~ShmRing();
+
+    // Creates (or replaces) the shared memory object /dev/shm/<name>.  Returns false on failure.
+    bool create(std::string name, uint32_t slot_count, uint64_t frame_capacity, uint64_t results_capacity);
+
+    // Maps an existing ring for reading.  Returns false on failure.
+    bool open(std::string name);
+
+    // Copies a frame and its results into the next slot.  Returns false if they don't fit in a slot.
+    bool write(const cv::Mat& frame, std::string identifier, int64_t epoch_time, const std::string& results);
+
+    // Finds the slot with the given identifier, and copies its frame and results.  Returns false if the frame
+    // is no longer (or not yet) in the ring.
+    bool read(std::string identifier, cv::Mat& frame, std::string& results);
+
+    bool isOpen();
+
+    // The number of frames that were too large to fit in a slot.
+    unsigned long rejected();
+
+  private:
+    ShmRingSlot* slotAt(uint64_t sequence);
+    void close();
+
+    std::string name;
+    bool owner;
+    int fd;
+    void* memory;
+    size_t memory_size;
+    ShmRingHeader* header;
+    unsigned long rejected_frames;
+
+    tthread::mutex mMutex;
+};
+
+#endif // OPENALPR_SHMRING_H
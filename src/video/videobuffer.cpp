@@ -35,7 +35,7 @@ VideoBuffer::~VideoBuffer()
 {
   if (dispatcher != NULL)
   {
-    dispatcher->active = false;
+    dispatcher->stop();
   }
 }
 
@@ -81,12 +81,37 @@ int VideoBuffer::getLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOf
   return dispatcher->getLatestFrame(frame, regionsOfInterest);
 }
 
+int VideoBuffer::waitForLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest)
+{
+  if (dispatcher == NULL)
+    return -1;
+  
+  return dispatcher->waitForLatestFrame(frame, regionsOfInterest);
+}
+
+
+bool VideoBuffer::waitForConnection()
+{
+  if (dispatcher == NULL)
+    return false;
+  
+  return dispatcher->waitForConnection();
+}
+
+bool VideoBuffer::isConnected()
+{
+  if (dispatcher == NULL)
+    return false;
+  
+  return dispatcher->isActive();
+}
+
 
 void VideoBuffer::disconnect()
 {
   if (dispatcher != NULL)
   {
-    dispatcher->active = false;
+    dispatcher->stop();
   }
   
   dispatcher = NULL;
@@ -127,6 +152,8 @@ void imageCollectionThread(void* arg)
         cap.open(dispatcher->mjpeg_url);
       }
       
+      dispatcher->setConnectionResult(cap.isOpened());
+      
       if (cap.isOpened())
       {
         dispatcher->log_info("Video stream connected");
@@ -143,6 +170,7 @@ void imageCollectionThread(void* arg)
     catch (const std::runtime_error& error)
     {
       // Error occured while trying to gather image.  Retry, don't exit.
+      dispatcher->setConnectionResult(false);
       std::stringstream ss;
       ss << "VideoBuffer exception: " << error.what();
       dispatcher->log_error( ss.str() );
@@ -150,6 +178,7 @@ void imageCollectionThread(void* arg)
     catch (cv::Exception e)
     {
       // OpenCV Exception occured while trying to gather image.  Retry, don't exit.
+      dispatcher->setConnectionResult(false);
       std::stringstream ss;
       ss << "VideoBuffer OpenCV exception: " << e.what();
       dispatcher->log_error( ss.str() );
@@ -188,9 +217,8 @@ void getALPRImages(cv::VideoCapture cap, VideoDispatcher* dispatcher)
 	  return;
 	}
 	
-	dispatcher->mMutex.lock();
+	tthread::lock_guard<tthread::mutex> guard(dispatcher->mMutex);
 	dispatcher->setLatestFrame(frame);
-	dispatcher->mMutex.unlock();
       }
       catch (const std::runtime_error& error)
       {
@@ -198,19 +226,14 @@ void getALPRImages(cv::VideoCapture cap, VideoDispatcher* dispatcher)
 	std::stringstream ss;
 	ss << "Exception happened " <<  error.what();
 	dispatcher->log_error(ss.str());
-	dispatcher->mMutex.unlock();
 	return;
       }
 
-      
-      dispatcher->mMutex.unlock();
-      
       if (hasImage == false)
 	break;
       
-
-      // Delay 15ms
-      sleep_ms(15);    
+      // No delay is needed here, since read() blocks until the next frame arrives.  Consumers
+      // always take the most recent frame, so older frames are simply replaced.
     }
     
     // Delay 100ms
@@ -21,6 +21,7 @@ class VideoDispatcher
     VideoDispatcher(std::string mjpeg_url, int fps)
     {
       this->active = true;
+      this->connection_state = CONNECTION_PENDING;
       this->latestFrameNumber = -1;
       this->lastFrameRead = -1;
       this->fps = fps;
@@ -32,32 +33,74 @@ class VideoDispatcher
     {
       tthread::lock_guard<tthread::mutex> guard(mMutex);
       
-      if (latestFrameNumber == lastFrameRead)
-        return -1;
+      return readLatestFrame(frame, regionsOfInterest);
+    }
+    
+    // Same as getLatestFrame, but blocks until a frame that hasn't been read yet is available.
+    // Returns -1 if the dispatcher is stopped while waiting.
+    int waitForLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest)
+    {
+      tthread::lock_guard<tthread::mutex> guard(mMutex);
       
-      frame->create(latestFrame.size(), latestFrame.type());
-      latestFrame.copyTo(*frame);
+      while (active && latestFrameNumber == lastFrameRead)
+        frameAvailable.wait(mMutex);
       
-      this->lastFrameRead = this->latestFrameNumber;
-      
-      // Copy the regionsOfInterest array
-      for (int i = 0; i < this->latestRegionsOfInterest.size(); i++)
-          regionsOfInterest.push_back(this->latestRegionsOfInterest[i]);
+      if (!active)
+        return -1;
       
-      return this->lastFrameRead;
+      return readLatestFrame(frame, regionsOfInterest);
     }
     
+    // The dispatcher keeps a reference to the frame rather than a copy, so the caller
+    // must not write into the same buffer again.  Must be called with mMutex locked.
     void setLatestFrame(cv::Mat frame)
     {      
-      frame.copyTo(this->latestFrame);
+      this->latestFrame = frame;
       this->latestRegionsOfInterest = calculateRegionsOfInterest(&this->latestFrame);
       
       this->latestFrameNumber++;
+      frameAvailable.notify_all();
+    }
+    
+    // Blocks until the first attempt to open the source has finished.  Returns true if it opened.
+    bool waitForConnection()
+    {
+      tthread::lock_guard<tthread::mutex> guard(mMutex);
+      
+      while (active && connection_state == CONNECTION_PENDING)
+        frameAvailable.wait(mMutex);
+      
+      return connection_state == CONNECTION_OPENED;
+    }
+    
+    // Records the outcome of the first attempt to open the source.  Later attempts (after the source drops) don't change it.
+    void setConnectionResult(bool opened)
+    {
+      tthread::lock_guard<tthread::mutex> guard(mMutex);
+      if (connection_state != CONNECTION_PENDING)
+        return;
+      
+      connection_state = opened ? CONNECTION_OPENED : CONNECTION_FAILED;
+      frameAvailable.notify_all();
+    }
+    
+    bool isActive()
+    {
+      tthread::lock_guard<tthread::mutex> guard(mMutex);
+      return active;
+    }
+    
+    // Stops the capture thread and wakes up anyone waiting for a frame.
+    void stop()
+    {
+      tthread::lock_guard<tthread::mutex> guard(mMutex);
+      this->active = false;
+      frameAvailable.notify_all();
     }
     
     virtual void log_info(std::string message)
     {
-      std::cout << message << std::endl;
+      std::cerr << "{\"info\": \"" << message << "\"}" << std::endl;
     }
     virtual void log_error(std::string error)
     {
@@ -76,6 +119,9 @@ class VideoDispatcher
     
     bool active;
     
+    enum ConnectionState { CONNECTION_PENDING, CONNECTION_OPENED, CONNECTION_FAILED };
+    ConnectionState connection_state;
+    
     int latestFrameNumber;
     int lastFrameRead;
     
@@ -84,8 +130,27 @@ class VideoDispatcher
     tthread::mutex mMutex;
     
   private:
+    // Must be called with mMutex locked.
+    int readLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest)
+    {
+      if (latestFrameNumber == lastFrameRead)
+        return -1;
+      
+      // The capture thread never writes into a frame once it has been handed over, so no copy is needed.
+      *frame = latestFrame;
+      
+      this->lastFrameRead = this->latestFrameNumber;
+      
+      // Copy the regionsOfInterest array
+      for (int i = 0; i < this->latestRegionsOfInterest.size(); i++)
+          regionsOfInterest.push_back(this->latestRegionsOfInterest[i]);
+      
+      return this->lastFrameRead;
+    }
+    
     cv::Mat latestFrame;
     std::vector<cv::Rect> latestRegionsOfInterest;
+    tthread::condition_variable frameAvailable;
 };
 
 class VideoBuffer
@@ -102,6 +167,18 @@ class VideoBuffer
     // If no frames are available, or the latest has already been grabbed, returns -1.
     // regionsOfInterest is set to a list of good regions to check for license plates.  Default is one rectangle for the entire frame.
     int getLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest);
+    
+    // Blocks until a new frame is available, then behaves like getLatestFrame.  Any frames captured
+    // since the previous call are skipped, so the difference between the returned frame numbers
+    // tells the caller how many frames were never analyzed.  Returns -1 once disconnected.
+    int waitForLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest);
+
+    // Blocks until the first attempt to open the source has finished.  Returns false if the source couldn't be opened,
+    // or if the buffer isn't connected.  The buffer keeps trying to open it either way, until it is disconnected.
+    bool waitForConnection();
+    
+    // False once disconnected.
+    bool isConnected();
 
     void disconnect();
     